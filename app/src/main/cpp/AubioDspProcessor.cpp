@@ -2,9 +2,147 @@
 // Created by Tarun.S on 13-11-2024.
 //
 
+#include <cmath>
 #include "logging_macros.h"
 #include "AubioDspProcessor.h"
 
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/**
+ * Creates the pre-emphasis biquad filter applied to every analysed channel.
+ *
+ * @param sampleRate The sample rate of the audio.
+ * @return A newly allocated aubio filter, to be released with del_aubio_filter.
+ */
+static aubio_filter_t* newPreEmphasisFilter(const float sampleRate) {
+    aubio_filter_t* filter = new_aubio_filter(3);
+    // Change filter response by setting biquad coefficients.
+    aubio_filter_set_biquad(filter,
+                            1.00000285
+            ,-1.93078064
+            ,0.95054174
+            ,-1.93078064
+            ,0.95054459
+    );
+    aubio_filter_set_samplerate(filter,sampleRate);
+    return filter;
+}
+
+/**
+ * Creates a second order low-pass biquad, the one of the Audio EQ Cookbook.
+ *
+ * @param sampleRate The sample rate of the filtered signal.
+ * @param cutoff The cutoff frequency.
+ * @param q The quality factor, two sections of 0.5412 and 1.3066 make a fourth order Butterworth filter.
+ * @return A newly allocated aubio filter, to be released with del_aubio_filter.
+ */
+static aubio_filter_t* newLowPassFilter(const double sampleRate, const double cutoff, const double q) {
+    const double w0 = 2.0 * M_PI * cutoff / sampleRate;
+    const double alpha = std::sin(w0) / (2.0 * q);
+    const double a0 = 1.0 + alpha;
+    aubio_filter_t* filter = new_aubio_filter(3);
+    aubio_filter_set_biquad(filter, (1.0 - std::cos(w0)) / (2.0 * a0), (1.0 - std::cos(w0)) / a0,
+                            (1.0 - std::cos(w0)) / (2.0 * a0), -2.0 * std::cos(w0) / a0, (1.0 - alpha) / a0);
+    aubio_filter_set_samplerate(filter, static_cast<uint_t>(sampleRate));
+    return filter;
+}
+
+/**
+ * Creates a Mel filter bank with the same settings as the main one, for another FFT size or sample rate.
+ *
+ * @param bands The number of bands.
+ * @param winS The FFT size.
+ * @param sampleRate The sample rate of the transformed signal.
+ * @param fMin The minimum frequency of the bands.
+ * @param fMax The maximum frequency of the bands, below the Nyquist frequency.
+ * @return A newly allocated aubio filter bank, to be released with del_aubio_filterbank.
+ */
+static aubio_filterbank_t* newMelFilterBank(const size_t bands, const size_t winS, const float sampleRate,
+                                            const float fMin, const float fMax) {
+    aubio_filterbank_t* filterBank = new_aubio_filterbank(bands, winS);
+    aubio_filterbank_set_norm(filterBank, 1.0f);
+    aubio_filterbank_set_power(filterBank, 4.0f);
+    aubio_filterbank_set_mel_coeffs(filterBank, sampleRate, fMin, fMax);
+    return filterBank;
+}
+
+/**
+ * Finds the first Mel band centered at or above a frequency, with the HTK formula aubio uses.
+ *
+ * @param bands The number of bands.
+ * @param fMin The minimum frequency of the bands.
+ * @param fMax The maximum frequency of the bands.
+ * @param frequency The frequency.
+ * @return The band index, bands if all of them are centered below.
+ */
+static size_t findBandAbove(const size_t bands, const double fMin, const double fMax, const double frequency) {
+    auto hzToMel = [](double hz) { return 2595.0 * std::log10(1.0 + hz / 700.0); };
+    const double start = hzToMel(fMin);
+    const double step = (hzToMel(fMax) - start) / static_cast<double>(bands + 1u);
+    for (size_t band = 0; band < bands; band++) {
+        const double center = 700.0 * (std::pow(10.0, (start + step * static_cast<double>(band + 1u)) / 2595.0) - 1.0);
+        if (center >= frequency) return band;
+    }
+    return bands;
+}
+
+/**
+ * Averages interleaved stereo frames into a mono buffer in a single pass.
+ *
+ * @param in Interleaved stereo samples, numFrames * 2 long.
+ * @param mono Output buffer, numFrames long.
+ * @param numFrames The number of frames to convert.
+ */
+static void downmixStereo(const float* in, float* mono, const size_t numFrames) {
+    size_t i = 0;
+#if defined(__ARM_NEON)
+    for (; i + 4 <= numFrames; i += 4) {
+        float32x4x2_t lr = vld2q_f32(in + 2 * i);
+        vst1q_f32(mono + i, vmulq_n_f32(vaddq_f32(lr.val[0], lr.val[1]), 0.5f));
+    }
+#endif
+    for (; i < numFrames; i++) {
+        mono[i] = 0.5f * (in[2 * i] + in[2 * i + 1]);
+    }
+}
+
+/**
+ * Splits interleaved stereo frames into separate left and right buffers in a single pass.
+ *
+ * @param in Interleaved stereo samples, numFrames * 2 long.
+ * @param left Output buffer for the left channel, numFrames long.
+ * @param right Output buffer for the right channel, numFrames long.
+ * @param numFrames The number of frames to convert.
+ */
+static void deinterleaveStereo(const float* in, float* left, float* right, const size_t numFrames) {
+    size_t i = 0;
+#if defined(__ARM_NEON)
+    for (; i + 4 <= numFrames; i += 4) {
+        float32x4x2_t lr = vld2q_f32(in + 2 * i);
+        vst1q_f32(left + i, lr.val[0]);
+        vst1q_f32(right + i, lr.val[1]);
+    }
+#endif
+    for (; i < numFrames; i++) {
+        left[i] = in[2 * i];
+        right[i] = in[2 * i + 1];
+    }
+}
+
+/**
+ * Shifts an analysis window left by one hop and appends the new hop at its end.
+ *
+ * @param frame The analysis window, winS long.
+ * @param hop The new samples, hopS long.
+ */
+static void slideWindow(fvec_t* frame, const fvec_t* hop) {
+    const uint_t keep = frame->length - hop->length;
+    std::copy(frame->data + hop->length, frame->data + frame->length, frame->data);
+    std::copy(hop->data, hop->data + hop->length, frame->data + keep);
+}
+
 /**
  * Constructor for the AubioDspProcessor class.
  * Initializes the necessary components for performing Mel-Bank filtering, including
@@ -16,25 +154,24 @@
  * @param sampleRate The sample rate of the audio.
  * @param fMin The minimum frequency for the Mel filter bank.
  * @param fMax The maximum frequency for the Mel filter bank.
+ * @param channelCount The number of interleaved channels in the audio data, 1 or 2.
+ * @param isMultiResolution true for the multi-resolution mono analysis, see analyzeMultiResolution().
+ * @param multiResFMin The minimum frequency of the Mel bands of the multi-resolution analysis, 0 for fMin.
+ * The stereo analysis keeps the bands from fMin.
  */
 AubioDspProcessor::AubioDspProcessor(const size_t winS, const size_t hopS, const size_t filterS,
-                                     const float sampleRate, const float fMin, const float fMax) {
+                                     const float sampleRate, const float fMin, const float fMax,
+                                     const size_t channelCount, const bool isMultiResolution, const float multiResFMin) :
+                                     _hopSize(hopS), _channelCount(channelCount), _onsetBeatTracker(hopS, sampleRate),
+                                     _isMultiResolution(isMultiResolution) {
+    assert((1u == channelCount || 2u == channelCount) && "Only mono and stereo input is supported.");
 
     // Initialize digital filter, pre-emphasis phase, set coefficients for biquadratic filter.
-    _sample = new_fvec(1);
-    _digitalFilter =     new_aubio_filter(3);
-    // Change filter response by setting biquad coefficients.
-    aubio_filter_set_biquad(_digitalFilter,
-                            1.00000285
-            ,-1.93078064
-            ,0.95054174
-            ,-1.93078064
-            ,0.95054459
-    );
-    aubio_filter_set_samplerate(_digitalFilter,sampleRate);
+    _sample = new_fvec(hopS);
+    _digitalFilter = newPreEmphasisFilter(sampleRate);
 
-    LOGI("AubioDspProcessor initialized with window size: %zu, hop size: %zu, filter size: %zu, sample rate: %.2f, frequency range: [%.2f, %.2f]",
-         winS, hopS, filterS, sampleRate, fMin, fMax);
+    LOGI("AubioDspProcessor initialized with window size: %zu, hop size: %zu, filter size: %zu, sample rate: %.2f, frequency range: [%.2f, %.2f], channels: %zu",
+         winS, hopS, filterS, sampleRate, fMin, fMax, channelCount);
 
 
     // Setup phase vocoder, fft size, window type.
@@ -50,40 +187,469 @@ AubioDspProcessor::AubioDspProcessor(const size_t winS, const size_t hopS, const
     // This seems to works great, without needing to rounding off values.
     aubio_filterbank_set_power(_filterBank,4.0f);
     aubio_filterbank_set_mel_coeffs(_filterBank,sampleRate, fMin,fMax);
+
+    // Reduced Mel filterbank with half the bands, used when the CPU budget is tight.
+    _melReduced = new_fvec(std::max<size_t>(filterS / 2u, 1u));
+    _filterBankReduced = new_aubio_filterbank(_melReduced->length, winS);
+    aubio_filterbank_set_norm(_filterBankReduced, 1.0f);
+    aubio_filterbank_set_power(_filterBankReduced, 4.0f);
+    aubio_filterbank_set_mel_coeffs(_filterBankReduced, sampleRate, fMin, fMax);
+
+    // Setup stereo and decimated analysis, a single FFT plan with one sliding window per channel.
+    // The phase vocoder swaps the window halves before its FFT, that only changes the phase,
+    // so the magnitudes computed here match the ones of the phase vocoder.
+    _frame = new_fvec(winS);
+    _sampleLeft = new_fvec(hopS);
+    _sampleRight = new_fvec(hopS);
+    _digitalFilterRight = newPreEmphasisFilter(sampleRate);
+    _fftPlan = new_aubio_fft(winS);
+    _window = new_aubio_window(const_cast<char_t*>("hanning"), winS);
+    _frameLeft = new_fvec(winS);
+    _frameRight = new_fvec(winS);
+    _windowed = new_fvec(winS);
+    _compLeft = new_fvec(winS);
+    _compRight = new_fvec(winS);
+    _fftLeft = new_cvec(winS);
+    _fftRight = new_cvec(winS);
+    _melLeft = new_fvec(filterS);
+    _melRight = new_fvec(filterS);
+
+    // Setup onset detection on the shared spectrum, spectral flux only needs the magnitudes.
+    // Onset picking and beat tracking run on the flux in _onsetBeatTracker.
+    _onsetDesc = new_aubio_specdesc("specflux", winS);
+    _onsetValue = new_fvec(1);
+
+    if (isMultiResolution) {
+        // The long FFT has winS points at a quarter of the sample rate: four times the bass resolution,
+        // updated every MULTI_RES_LONG_HOPS hops. The short FFT has winS / 2 points at the full rate, every hop.
+        const float longRate = sampleRate / MULTI_RES_DECIMATION;
+        const size_t shortS = winS / 2u;
+        const float bandFMin = 0.0f < multiResFMin ? multiResFMin : fMin;
+        assert(0u == hopS % MULTI_RES_DECIMATION && "The hop size must be a multiple of the decimation");
+        assert(hopS <= shortS && fMax <= longRate / 2.0f && MULTI_RES_ANTI_ALIAS_HZ < longRate / 2.0f);
+
+        _lowPassed = new_fvec(hopS);
+        // Fourth order Butterworth low-pass, aliasing stays more than 50 dB down below the crossover.
+        _antiAliasFilters[0] = newLowPassFilter(sampleRate, MULTI_RES_ANTI_ALIAS_HZ, 0.54119610);
+        _antiAliasFilters[1] = newLowPassFilter(sampleRate, MULTI_RES_ANTI_ALIAS_HZ, 1.30656296);
+        _decimatedHop = new_fvec(hopS / MULTI_RES_DECIMATION);
+        _longFrame = new_fvec(winS);
+        _longComp = new_fvec(winS);
+        _longFft = new_cvec(winS);
+        _longPlan = new_aubio_fft(winS);
+        _longFilterBank = newMelFilterBank(filterS, winS, longRate, bandFMin, fMax);
+        _longFilterBankReduced = newMelFilterBank(_melReduced->length, winS, longRate, bandFMin, fMax);
+        _longMel = new_fvec(filterS);
+        _longMelReduced = new_fvec(_melReduced->length);
+
+        _shortFrame = new_fvec(shortS);
+        _shortWindow = new_aubio_window(const_cast<char_t*>("hanning"), shortS);
+        _shortWindowed = new_fvec(shortS);
+        _shortComp = new_fvec(shortS);
+        _shortFft = new_cvec(shortS);
+        _shortPlan = new_aubio_fft(shortS);
+        _shortFilterBank = newMelFilterBank(filterS, shortS, sampleRate, bandFMin, fMax);
+        _shortFilterBankReduced = newMelFilterBank(_melReduced->length, shortS, sampleRate, bandFMin, fMax);
+        _shortMel = new_fvec(filterS);
+        _shortMelReduced = new_fvec(_melReduced->length);
+        _shortOnsetDesc = new_aubio_specdesc("specflux", shortS);
+
+        _splitBand = findBandAbove(filterS, bandFMin, fMax, MULTI_RES_CROSSOVER_HZ);
+        _splitBandReduced = findBandAbove(_melReduced->length, bandFMin, fMax, MULTI_RES_CROSSOVER_HZ);
+        LOGI("AubioDspProcessor multi-resolution analysis from %.2f Hz, bands below %zu from the long FFT", bandFMin, _splitBand);
+    }
 }
 
 /**
  * Applies the Mel-Bank filtering process on the provided audio data.
- * This includes applying a digital filter, performing phase vocoder time-frequency analysis,
- * and computing the Mel spectrogram using a filter bank.
+ * The interleaved input is down-mixed to mono and collected into hops, every complete hop goes through
+ * the digital filter, phase vocoder time-frequency analysis and the Mel filter bank.
  * The results are then passed to the given ExpFilter object for further processing.
+ * Onset and beat features are derived from the same spectrum, see getFeatures().
  *
- * @param audioData Pointer to the audio data buffer.
- * @param dataS The size of the audio data buffer (in samples).
+ * @param audioData Pointer to the interleaved audio data buffer.
+ * @param numFrames The number of frames in the audio data buffer.
  * @param melBank A shared pointer to an ExpFilter object that will be updated with Mel output data.
  */
-void AubioDspProcessor::doMelBank(void *audioData, const size_t dataS, std::shared_ptr<ExpFilter> melBank) {
+void AubioDspProcessor::doMelBank(void *audioData, const size_t numFrames, std::shared_ptr<ExpFilter> melBank) {
+    const auto* in = static_cast<const float*>(audioData);
+    _features.isOnset = false;
+    _features.isBeat = false;
+
+    size_t done = 0u;
+    while (done < numFrames) {
+        const size_t count = std::min(numFrames - done, _hopSize - _hopFill);
+        if (2u == _channelCount) {
+            downmixStereo(in + done * 2u, _sample->data + _hopFill, count);
+        } else {
+            std::copy(in + done, in + done + count, _sample->data + _hopFill);
+        }
+        _hopFill += count;
+        done += count;
+
+        if (_hopFill == _hopSize) {
+            analyzeMono(melBank);
+            _hopFill = 0u;
+        }
+    }
+}
+
+/**
+ * Applies the Mel-Bank filtering process on each channel of the provided stereo audio data.
+ * Both channels are split in a single pass, filtered and transformed with the same FFT plan,
+ * then projected on the shared Mel filter bank. The mono Mel-Bank is the mean of both channels,
+ * and the onset and beat features come from the mid spectrum, so no additional FFT is needed.
+ * Falls back to the mono analysis, mirrored on both channels, if the input is mono.
+ * The stereo and mono hops are collected separately, so switching between both analyses never mixes them.
+ *
+ * @param audioData Pointer to the interleaved audio data buffer.
+ * @param numFrames The number of frames in the audio data buffer.
+ * @param melBank A shared pointer to an ExpFilter object that will be updated with the mono Mel output data.
+ * @param leftMelBank A shared pointer to an ExpFilter object that will be updated with the left Mel output data.
+ * @param rightMelBank A shared pointer to an ExpFilter object that will be updated with the right Mel output data.
+ */
+void AubioDspProcessor::doStereoMelBank(void *audioData, const size_t numFrames, std::shared_ptr<ExpFilter> melBank,
+                                        std::shared_ptr<ExpFilter> leftMelBank, std::shared_ptr<ExpFilter> rightMelBank) {
+    if (2u != _channelCount) {
+        // Both channels mirror the mono Mel-Bank, also when no hop was completed by this call.
+        doMelBank(audioData, numFrames, melBank);
+        leftMelBank->valueVec = melBank->valueVec;
+        rightMelBank->valueVec = melBank->valueVec;
+        return;
+    }
+
+    const auto* in = static_cast<const float*>(audioData);
+    _features.isOnset = false;
+    _features.isBeat = false;
 
-    // Set the length of the sample vector to match the audio data size
-    _sample->length = dataS;
-    _sample->data = (float*)audioData;  // Assign audio data to sample vector
+    size_t done = 0u;
+    while (done < numFrames) {
+        const size_t count = std::min(numFrames - done, _hopSize - _stereoHopFill);
+        deinterleaveStereo(in + done * 2u, _sampleLeft->data + _stereoHopFill, _sampleRight->data + _stereoHopFill, count);
+        _stereoHopFill += count;
+        done += count;
 
+        if (_stereoHopFill == _hopSize) {
+            analyzeStereo(melBank, leftMelBank, rightMelBank);
+            _stereoHopFill = 0u;
+        }
+    }
+}
+
+/**
+ * Analyses one complete mono hop held in _sample.
+ *
+ * @param melBank The ExpFilter to update with the Mel output data.
+ */
+void AubioDspProcessor::analyzeMono(const std::shared_ptr<ExpFilter>& melBank) {
     // Apply the digital filter on the audio sample
     aubio_filter_do(_digitalFilter, _sample);
 
-    // Clear the FFT vector before processing
-    cvec_zeros(_fft);
-    // Perform phase vocoder processing (time-frequency analysis)
-    aubio_pvoc_do(_phaseVocoder, _sample, _fft);
+    if (_isMultiResolution) {
+        analyzeMultiResolution(melBank);
+        return;
+    }
+
+    // The phase vocoder can't slide its window without transforming it, so decimated analysis keeps its own
+    // window and only transforms it on analysis hops. It follows every hop, so it is current when decimation starts.
+    slideWindow(_frame, _sample);
+    if (1u == _hopDecimation) {
+        if (_isPvocStale) refillPhaseVocoder();
+        _analyzedHopCount++;
+        // Clear the FFT vector before processing
+        cvec_zeros(_fft);
+        // Perform phase vocoder processing (time-frequency analysis)
+        aubio_pvoc_do(_phaseVocoder, _sample, _fft);
+    } else {
+        _isPvocStale = true;
+        if (!isAnalysisHop()) {
+            // Hold the last detection value so the beat tracker keeps its timing.
+            _onsetBeatTracker.hold(_features);
+            return;
+        }
+        fvec_weighted_copy(_frame, _window, _windowed);
+        aubio_fft_do_complex(_fftPlan, _windowed, _compLeft);
+        aubio_fft_get_norm(_compLeft, _fft);
+    }
+
+    // Derive onset and beat features from the same spectrum, no additional FFT needed.
+    // This must come first, the filter bank raises the magnitudes to its power in place.
+    detectFeatures();
+    computeLogSpectrum();
 
-    // Clear the Mel output vector before computation
-    fvec_zeros(_melOutput);
     // Apply the Mel filter bank to the FFT result
-    aubio_filterbank_do(_filterBank, _fft, _melOutput);
+    projectMel(_fft, _melOutput);
 
     // Update the ExpFilter with the computed Mel output
     melBank->update(_melOutput->data, _melOutput->length);
+}
+
+/**
+ * Brings the window of the phase vocoder up to date after decimated hops, before it transforms the hop in _sample.
+ * The samples of _frame that precede that hop are fed again, in hops whose spectra are discarded.
+ */
+void AubioDspProcessor::refillPhaseVocoder() {
+    const size_t history = _frame->length - _hopSize;
+    fvec_t refill{static_cast<uint_t>(_hopSize), _windowed->data};
+    for (size_t hops = (history + _hopSize - 1u) / _hopSize; hops > 0u; hops--) {
+        // Starts before the window when the history isn't a whole number of hops, those samples are shifted out.
+        const auto start = static_cast<ptrdiff_t>(history) - static_cast<ptrdiff_t>(hops * _hopSize);
+        for (size_t i = 0; i < _hopSize; i++) {
+            const ptrdiff_t n = start + static_cast<ptrdiff_t>(i);
+            refill.data[i] = 0 <= n ? _frame->data[n] : 0.0f;
+        }
+        aubio_pvoc_do(_phaseVocoder, &refill, _fft);
+    }
+    _isPvocStale = false;
+}
+
+/**
+ * Analyses one complete mono hop held in _sample, already pre-emphasized, with two FFTs.
+ * The low bands come from the long FFT of the decimated input, held between two long FFTs, the high bands
+ * and the onsets from the short FFT. The short magnitudes are doubled, to the scale of a winS FFT, so a sine
+ * gives about the same energy, summed over the bands, in both spectra and the merged bands line up.
+ *
+ * @param melBank The ExpFilter to update with the merged Mel output data.
+ */
+void AubioDspProcessor::analyzeMultiResolution(const std::shared_ptr<ExpFilter>& melBank) {
+    decimateHop();
+    slideWindow(_longFrame, _decimatedHop);
+    slideWindow(_shortFrame, _sample);
+    if (!isAnalysisHop()) {
+        _onsetBeatTracker.hold(_features);
+        return;
+    }
+
+    fvec_weighted_copy(_shortFrame, _shortWindow, _shortWindowed);
+    aubio_fft_do_complex(_shortPlan, _shortWindowed, _shortComp);
+    aubio_fft_get_norm(_shortComp, _shortFft);
+    const smpl_t shortScale = static_cast<smpl_t>(_longFrame->length) / static_cast<smpl_t>(_shortFrame->length);
+    for (uint_t i = 0; i < _shortFft->length; i++) {
+        _shortFft->norm[i] *= shortScale;
+    }
+
+    // Half the window of the single FFT analysis, so onsets are detected earlier.
+    aubio_specdesc_do(_shortOnsetDesc, _shortFft, _onsetValue);
+    _onsetBeatTracker.process(_onsetValue->data[0], _features);
+
+    const bool isLongHop = 0u == _longHopCounter;
+    _longHopCounter = (_longHopCounter + 1u) % MULTI_RES_LONG_HOPS;
+    if (isLongHop) {
+        fvec_weighted_copy(_longFrame, _window, _windowed);
+        aubio_fft_do_complex(_longPlan, _windowed, _longComp);
+        aubio_fft_get_norm(_longComp, _longFft);
+    }
+    if (_logSpectrum) computeMultiResolutionLogSpectrum(isLongHop);
+
+    // The filter banks raise the magnitudes to their power in place, so the projections come last.
+    fvec_t* longMel = _reducedBands ? _longMelReduced : _longMel;
+    fvec_t* shortMel = _reducedBands ? _shortMelReduced : _shortMel;
+    if (isLongHop) {
+        fvec_zeros(longMel);
+        aubio_filterbank_do(_reducedBands ? _longFilterBankReduced : _longFilterBank, _longFft, longMel);
+    }
+    fvec_zeros(shortMel);
+    aubio_filterbank_do(_reducedBands ? _shortFilterBankReduced : _shortFilterBank, _shortFft, shortMel);
+
+    // With reduced bands each band is repeated twice, like projectMel() does.
+    const size_t splitBand = _reducedBands ? _splitBandReduced : _splitBand;
+    for (uint_t i = 0; i < _melOutput->length; i++) {
+        const uint_t band = _reducedBands ? std::min<uint_t>(i / 2u, shortMel->length - 1u) : i;
+        _melOutput->data[i] = band < splitBand ? longMel->data[band] : shortMel->data[band];
+    }
+    melBank->update(_melOutput->data, _melOutput->length);
+}
+
+/**
+ * Low-pass filters the hop in _sample and keeps one sample out of MULTI_RES_DECIMATION in _decimatedHop.
+ */
+void AubioDspProcessor::decimateHop() {
+    fvec_copy(_sample, _lowPassed);
+    aubio_filter_do(_antiAliasFilters[0], _lowPassed);
+    aubio_filter_do(_antiAliasFilters[1], _lowPassed);
+    for (uint_t i = 0; i < _decimatedHop->length; i++) {
+        _decimatedHop->data[i] = _lowPassed->data[i * MULTI_RES_DECIMATION];
+    }
+}
+
+/**
+ * Computes the log-frequency spectrum of the multi-resolution analysis. The bands below the crossover come from
+ * the long bins, the log spectrum was built with them as its finer spectrum, and are only updated with the long FFT.
+ * The other bands come from the short bins, twice as wide, interpolated onto the bins of a winS FFT.
+ *
+ * @param isLongHop true if the long spectrum was just computed.
+ */
+void AubioDspProcessor::computeMultiResolutionLogSpectrum(bool isLongHop) {
+    if (isLongHop && !_longLogPower.empty()) {
+        for (uint_t i = 0; i < _longFft->length; i++) {
+            _longLogPower[i] = _longFft->norm[i] * _longFft->norm[i];
+        }
+    }
+    for (size_t k = 0; k < _logPower.size(); k++) {
+        const size_t bin = k / 2u;
+        const smpl_t power = _shortFft->norm[bin] * _shortFft->norm[bin];
+        if ((k & 1u) && bin + 1u < _shortFft->length) {
+            _logPower[k] = 0.5f * (power + _shortFft->norm[bin + 1u] * _shortFft->norm[bin + 1u]);
+        } else {
+            _logPower[k] = power;
+        }
+    }
+    _logSpectrum->process(_logPower.data(), _longLogPower.empty() ? nullptr : _longLogPower.data(), *_logLevels);
+}
+
+/**
+ * Analyses one complete stereo hop held in _sampleLeft and _sampleRight.
+ *
+ * @param melBank The ExpFilter to update with the mean Mel output data.
+ * @param leftMelBank The ExpFilter to update with the left Mel output data.
+ * @param rightMelBank The ExpFilter to update with the right Mel output data.
+ */
+void AubioDspProcessor::analyzeStereo(const std::shared_ptr<ExpFilter>& melBank, const std::shared_ptr<ExpFilter>& leftMelBank,
+                                      const std::shared_ptr<ExpFilter>& rightMelBank) {
+    aubio_filter_do(_digitalFilter, _sampleLeft);
+    aubio_filter_do(_digitalFilterRight, _sampleRight);
+
+    slideWindow(_frameLeft, _sampleLeft);
+    slideWindow(_frameRight, _sampleRight);
+    if (!isAnalysisHop()) {
+        _onsetBeatTracker.hold(_features);
+        return;
+    }
+
+    computeStereoSpectra();
+
+    projectMel(_fftLeft, _melLeft);
+    projectMel(_fftRight, _melRight);
+
+    for (uint_t i = 0; i < _melOutput->length; i++) {
+        _melOutput->data[i] = 0.5f * (_melLeft->data[i] + _melRight->data[i]);
+    }
+
+    leftMelBank->update(_melLeft->data, _melLeft->length);
+    rightMelBank->update(_melRight->data, _melRight->length);
+    melBank->update(_melOutput->data, _melOutput->length);
+
+    // The mid spectrum in _fft drives the onset and beat features, and the log-frequency spectrum.
+    detectFeatures();
+    computeLogSpectrum();
+}
+
+/**
+ * Transforms the left and right analysis windows back to back with the same FFT plan,
+ * so its tables stay hot in cache.
+ * The mid spectrum is the average of both complex spectra, it is written to _fft without another FFT.
+ */
+void AubioDspProcessor::computeStereoSpectra() {
+    const uint_t winS = _frameLeft->length;
 
+    fvec_weighted_copy(_frameLeft, _window, _windowed);
+    aubio_fft_do_complex(_fftPlan, _windowed, _compLeft);
+    fvec_weighted_copy(_frameRight, _window, _windowed);
+    aubio_fft_do_complex(_fftPlan, _windowed, _compRight);
+
+    aubio_fft_get_norm(_compLeft, _fftLeft);
+    aubio_fft_get_norm(_compRight, _fftRight);
+
+    // Reuse the windowed buffer for the complex mid spectrum.
+    for (uint_t i = 0; i < winS; i++) {
+        _windowed->data[i] = 0.5f * (_compLeft->data[i] + _compRight->data[i]);
+    }
+    aubio_fft_get_norm(_windowed, _fft);
+}
+
+/**
+ * Projects a spectrum on the Mel filter bank. With reduced bands, the half-size filter bank is used
+ * and each of its bands is repeated twice, so the output always has the full band count.
+ * The filter bank raises the magnitudes of the spectrum to its power in place, anything else computed from
+ * the spectrum, like the spectral flux, must come before.
+ *
+ * @param spectrum The input spectrum.
+ * @param mel The output Mel energies, filterS long.
+ */
+void AubioDspProcessor::projectMel(const cvec_t* spectrum, fvec_t* mel) {
+    if (!_reducedBands) {
+        fvec_zeros(mel);
+        aubio_filterbank_do(_filterBank, spectrum, mel);
+        return;
+    }
+
+    fvec_zeros(_melReduced);
+    aubio_filterbank_do(_filterBankReduced, spectrum, _melReduced);
+    for (uint_t i = 0; i < mel->length; i++) {
+        mel->data[i] = _melReduced->data[std::min<uint_t>(i / 2u, _melReduced->length - 1u)];
+    }
+}
+
+/**
+ * Advances the hop counter and tells whether the current hop is due for a spectrum, counting the analysed hops.
+ *
+ * @return true once every _hopDecimation hops.
+ */
+bool AubioDspProcessor::isAnalysisHop() {
+    const bool isDue = 0u == _hopCounter;
+    _hopCounter = (_hopCounter + 1u) % _hopDecimation;
+    if (isDue) _analyzedHopCount++;
+    return isDue;
+}
+
+/**
+ * Only computes the spectrum once every few hops, the skipped hops still slide the analysis window.
+ * Must be called from the thread running the analysis.
+ *
+ * @param decimation 1 to analyse every hop, 2 to analyse every other hop and so on.
+ */
+void AubioDspProcessor::setHopDecimation(const uint32_t decimation) {
+    _hopDecimation = std::max<uint32_t>(decimation, 1u);
+    _hopCounter = 0u;
+}
+
+/**
+ * Switches between the full Mel filter bank and the one with half the bands.
+ * Must be called from the thread running the analysis.
+ *
+ * @param isReduced true to use half the bands.
+ */
+void AubioDspProcessor::setReducedBands(const bool isReduced) {
+    _reducedBands = isReduced;
+}
+
+/**
+ * Computes the spectral flux of the current spectrum, then picks onsets and tracks beats from it.
+ */
+void AubioDspProcessor::detectFeatures() {
+    aubio_specdesc_do(_onsetDesc, _fft, _onsetValue);
+    _onsetBeatTracker.process(_onsetValue->data[0], _features);
+}
+
+/**
+ * Computes the log-frequency spectrum of _fft, if one was set.
+ */
+void AubioDspProcessor::computeLogSpectrum() {
+    if (!_logSpectrum) return;
+
+    for (uint_t i = 0; i < _fft->length; i++) {
+        _logPower[i] = _fft->norm[i] * _fft->norm[i];
+    }
+    _logSpectrum->process(_logPower.data(), *_logLevels);
+}
+
+/**
+ * Starts or stops computing a log-frequency spectrum on every analysis hop.
+ * Must be called from the thread running the analysis, allocates.
+ *
+ * @param logSpectrum The band kernels, built for winS, nullptr to stop computing it. The multi-resolution analysis
+ * gives its long spectrum to one built with the long FFT as its finer spectrum.
+ * @param levels The ExpFilter to update with the band levels.
+ */
+void AubioDspProcessor::setLogSpectrum(std::shared_ptr<LogSpectrum> logSpectrum, std::shared_ptr<ExpFilter> levels) {
+    assert((!logSpectrum || logSpectrum->getBinCount() == _fft->length) && "Log spectrum built for another FFT size");
+    assert((!logSpectrum || 0u == logSpectrum->getFineBinCount() ||
+            (_isMultiResolution && logSpectrum->getFineBinCount() == _longFft->length)) &&
+           "Log spectrum built for another long FFT");
+    _logSpectrum = std::move(logSpectrum);
+    _logLevels = std::move(levels);
+    _logPower.resize(_logSpectrum ? _fft->length : 0u);
+    _longLogPower.assign(_logSpectrum && 0u != _logSpectrum->getFineBinCount() ? _longFft->length : 0u, 0.0f);
 }
 
 /**
@@ -92,10 +658,54 @@ void AubioDspProcessor::doMelBank(void *audioData, const size_t dataS, std::shar
  */
 AubioDspProcessor::~AubioDspProcessor() {
     // Release the dynamically allocated memory for each DSP component
+    if (_isMultiResolution) {
+        del_aubio_specdesc(_shortOnsetDesc);
+        del_fvec(_shortMelReduced);
+        del_fvec(_shortMel);
+        del_aubio_filterbank(_shortFilterBankReduced);
+        del_aubio_filterbank(_shortFilterBank);
+        del_aubio_fft(_shortPlan);
+        del_cvec(_shortFft);
+        del_fvec(_shortComp);
+        del_fvec(_shortWindowed);
+        del_fvec(_shortWindow);
+        del_fvec(_shortFrame);
+        del_fvec(_longMelReduced);
+        del_fvec(_longMel);
+        del_aubio_filterbank(_longFilterBankReduced);
+        del_aubio_filterbank(_longFilterBank);
+        del_aubio_fft(_longPlan);
+        del_cvec(_longFft);
+        del_fvec(_longComp);
+        del_fvec(_longFrame);
+        del_fvec(_decimatedHop);
+        del_aubio_filter(_antiAliasFilters[1]);
+        del_aubio_filter(_antiAliasFilters[0]);
+        del_fvec(_lowPassed);
+    }
+    del_fvec(_onsetValue);
+    del_aubio_specdesc(_onsetDesc);
+    del_fvec(_melRight);
+    del_fvec(_melLeft);
+    del_cvec(_fftRight);
+    del_cvec(_fftLeft);
+    del_fvec(_compRight);
+    del_fvec(_compLeft);
+    del_fvec(_windowed);
+    del_fvec(_frameRight);
+    del_fvec(_frameLeft);
+    del_fvec(_window);
+    del_aubio_fft(_fftPlan);
+    del_aubio_filter(_digitalFilterRight);
+    del_fvec(_sampleRight);
+    del_fvec(_sampleLeft);
+    del_fvec(_frame);
+    del_aubio_filterbank(_filterBankReduced);
+    del_fvec(_melReduced);
     del_fvec(_melOutput);
     del_aubio_filterbank(_filterBank);
     del_cvec(_fft);
     del_aubio_pvoc(_phaseVocoder);
-//    del_fvec(_sample); // do not delete audio sample data.
+    del_fvec(_sample);
     del_aubio_filter(_digitalFilter);
 }
\ No newline at end of file
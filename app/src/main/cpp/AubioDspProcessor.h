@@ -5,30 +5,129 @@
 #ifndef LEDFX_AUBIODSPPROCESSOR_H
 #define LEDFX_AUBIODSPPROCESSOR_H
 
+#include <vector>
 #include "ExpFilter.h"
 #include "types.h"
 #include "cvec.h"
 #include "fvec.h"
 #include "spectral/phasevoc.h"
-#include "oboe/Oboe.h"
+#include "spectral/fft.h"
+#include "spectral/specdesc.h"
 #include "aubio.h"
 #include "IDspProcessor.h"
+#include "OnsetBeatTracker.h"
+
+#define MULTI_RES_DECIMATION 4u          // Sample rate divider of the long FFT, winS points at the reduced rate.
+#define MULTI_RES_LONG_HOPS 2u           // Analysis hops between two long FFTs.
+#define MULTI_RES_CROSSOVER_HZ 1000.0    // Bands centered below come from the long FFT, the others from the short one.
+#define MULTI_RES_ANTI_ALIAS_HZ 2000.0   // Cutoff of the low-pass filter applied before decimating.
 
 class AubioDspProcessor : public IDspProcessor {
     AubioDspProcessor()= delete;
 
+const size_t _hopSize;
+const size_t _channelCount;
+size_t _hopFill = 0u;          // Frames already collected for the next mono hop.
+size_t _stereoHopFill = 0u;    // Same, for the next stereo hop, the two paths collect into their own buffers.
+uint32_t _hopDecimation = 1u;  // Spectrum computed once every _hopDecimation hops.
+uint32_t _hopCounter = 0u;
+uint64_t _analyzedHopCount = 0u;  // Hops whose spectrum was computed.
+bool _reducedBands = false;
+bool _isPvocStale = false;     // The phase vocoder missed the hops analysed from _frame, refilled before it is used again.
+
 fvec_t* _sample = nullptr;
 aubio_filter_t* _digitalFilter = nullptr;
 aubio_pvoc_t* _phaseVocoder = nullptr;
 aubio_filterbank_t* _filterBank = nullptr;
 fvec_t* _melOutput = nullptr;
 cvec_t* _fft = nullptr;
+aubio_filterbank_t* _filterBankReduced = nullptr;
+fvec_t* _melReduced = nullptr;
+
+// Stereo and decimated analysis, all windows go through the same FFT plan and share the Mel filterbank.
+fvec_t* _frame = nullptr;      // Sliding mono analysis window, follows every hop but is only transformed when decimating.
+fvec_t* _sampleLeft = nullptr;
+fvec_t* _sampleRight = nullptr;
+aubio_filter_t* _digitalFilterRight = nullptr;
+aubio_fft_t* _fftPlan = nullptr;
+fvec_t* _window = nullptr;
+fvec_t* _frameLeft = nullptr;  // Sliding analysis windows, winS long.
+fvec_t* _frameRight = nullptr;
+fvec_t* _windowed = nullptr;
+fvec_t* _compLeft = nullptr;   // Complex spectra in aubio's real/imag layout.
+fvec_t* _compRight = nullptr;
+cvec_t* _fftLeft = nullptr;
+cvec_t* _fftRight = nullptr;
+fvec_t* _melLeft = nullptr;
+fvec_t* _melRight = nullptr;
+
+// Onset and beat detection, computed from the same _fft as the Mel-Bank.
+aubio_specdesc_t* _onsetDesc = nullptr;
+fvec_t* _onsetValue = nullptr;
+OnsetBeatTracker _onsetBeatTracker;
+AudioFeatures _features;
+
+// Optional log-frequency spectrum, computed from _fft like the features.
+std::shared_ptr<LogSpectrum> _logSpectrum;
+std::shared_ptr<ExpFilter> _logLevels;
+std::vector<float> _logPower;  // Squared magnitudes of _fft.
+std::vector<float> _longLogPower;  // Squared magnitudes of the last long FFT, for the bands below the crossover.
+
+// Multi-resolution mono analysis, only allocated when enabled. A long FFT of the decimated input resolves the low
+// bands, a short FFT at the full rate follows the high bands and the onsets.
+const bool _isMultiResolution;
+uint32_t _longHopCounter = 0u;
+size_t _splitBand = 0u;         // First band projected from the short spectrum.
+size_t _splitBandReduced = 0u;  // Same, for the reduced filter bank.
+fvec_t* _lowPassed = nullptr;   // Hop after the anti-aliasing filters, before decimation.
+aubio_filter_t* _antiAliasFilters[2] = {nullptr, nullptr};
+fvec_t* _decimatedHop = nullptr;
+fvec_t* _longFrame = nullptr;   // Sliding window of the decimated input, winS long.
+fvec_t* _longComp = nullptr;
+cvec_t* _longFft = nullptr;
+aubio_fft_t* _longPlan = nullptr;
+aubio_filterbank_t* _longFilterBank = nullptr;
+aubio_filterbank_t* _longFilterBankReduced = nullptr;
+fvec_t* _longMel = nullptr;     // Low bands of the last long FFT, held until the next one.
+fvec_t* _longMelReduced = nullptr;
+fvec_t* _shortFrame = nullptr;  // Sliding window of the full rate input, winS / 2 long.
+fvec_t* _shortWindow = nullptr;
+fvec_t* _shortWindowed = nullptr;
+fvec_t* _shortComp = nullptr;
+cvec_t* _shortFft = nullptr;
+aubio_fft_t* _shortPlan = nullptr;
+aubio_filterbank_t* _shortFilterBank = nullptr;
+aubio_filterbank_t* _shortFilterBankReduced = nullptr;
+fvec_t* _shortMel = nullptr;
+fvec_t* _shortMelReduced = nullptr;
+aubio_specdesc_t* _shortOnsetDesc = nullptr;
+
+void analyzeMono(const std::shared_ptr<ExpFilter>& melBank);
+void refillPhaseVocoder();
+void analyzeMultiResolution(const std::shared_ptr<ExpFilter>& melBank);
+void decimateHop();
+void computeMultiResolutionLogSpectrum(bool isLongHop);
+void analyzeStereo(const std::shared_ptr<ExpFilter>& melBank, const std::shared_ptr<ExpFilter>& leftMelBank,
+                   const std::shared_ptr<ExpFilter>& rightMelBank);
+void computeStereoSpectra();
+void projectMel(const cvec_t* spectrum, fvec_t* mel);
+bool isAnalysisHop();
+void detectFeatures();
+void computeLogSpectrum();
 
 public:
 
-    AubioDspProcessor(const size_t winS, const size_t hopS, const size_t filterS, const float sampleRate, const float fMin, const float fMax);
+    AubioDspProcessor(const size_t winS, const size_t hopS, const size_t filterS, const float sampleRate, const float fMin, const float fMax,
+                      const size_t channelCount = 1u, const bool isMultiResolution = false, const float multiResFMin = 0.0f);
 
-    void doMelBank(void* audioData, const size_t dataS, std::shared_ptr<ExpFilter> melBank);
+    void doMelBank(void* audioData, const size_t numFrames, std::shared_ptr<ExpFilter> melBank);
+    void doStereoMelBank(void* audioData, const size_t numFrames, std::shared_ptr<ExpFilter> melBank,
+                         std::shared_ptr<ExpFilter> leftMelBank, std::shared_ptr<ExpFilter> rightMelBank);
+    const AudioFeatures& getFeatures() const override { return _features; }
+    void setHopDecimation(const uint32_t decimation) override;
+    uint64_t getAnalyzedHopCount() const override { return _analyzedHopCount; }
+    void setReducedBands(const bool isReduced) override;
+    void setLogSpectrum(std::shared_ptr<LogSpectrum> logSpectrum, std::shared_ptr<ExpFilter> levels) override;
     ~AubioDspProcessor();
 };
 
@@ -0,0 +1,16 @@
+#ifndef LEDFX_AUDIOFEATURES_H
+#define LEDFX_AUDIOFEATURES_H
+
+/**
+ * @brief Per-hop audio features derived from the shared spectrum of a DSP processor.
+ * Mel energies are delivered through the ExpFilter passed to doMelBank, everything else lives here.
+ */
+struct AudioFeatures {
+    float flux = 0.0f;          // Spectral flux (onset detection function) of the latest hop.
+    bool isOnset = false;       // True if an onset was picked on the latest hop.
+    bool isBeat = false;        // True if the beat tracker predicted a beat on the latest hop.
+    float bpm = 0.0f;           // Current tempo estimate, 0 if no consistent tempo was found yet.
+    float bpmConfidence = 0.0f; // Confidence of the tempo estimate, 0 if no consistent tempo was found yet.
+};
+
+#endif //LEDFX_AUDIOFEATURES_H
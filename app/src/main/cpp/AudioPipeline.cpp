@@ -0,0 +1,299 @@
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include "logging_macros.h"
+#include "AudioPipeline.h"
+#include "AubioDspProcessor.h"
+#include "FixedPointDspProcessor.h"
+#include "StaticDspProcessor.h"
+#include "LoadGovernor.h"
+
+/**
+ * Constructor for the AudioPipeline class.
+ * Sets up the smoothing filters, the float DSP processor and the LED frame.
+ *
+ * @param sampleRate The sample rate of the audio.
+ * @param channelCount The number of interleaved channels of the audio, 1 or 2.
+ * @param numLeds The number of LEDs to render.
+ */
+AudioPipeline::AudioPipeline(int32_t sampleRate, size_t channelCount, size_t numLeds) :
+        _sampleRate(sampleRate), _channelCount(channelCount),
+        _silenceDetector(sampleRate, SILENCE_ENTER_LEVEL, SILENCE_EXIT_LEVEL, SILENCE_HOLD_MS, SILENCE_KEEPALIVE_MS) {
+
+    // Initialize the mel filter bank with an initial value of 0.0, using a decay factor of 0.70 and a rise factor of 0.90.
+    // This is used for processing frequency data with a smooth transition.
+    // The filter is initially not enabled (false), and the filter size is defined by FILTER_SIZE.
+    _melBankOutput = std::make_shared<ExpFilter>(0.0f, 0.70f, 0.90f, false, FILTER_SIZE);
+    LOGD("Mel filter bank initialized with decay (0.70) and rise (0.90) factors.");
+
+    // Per channel mel filter banks for stereo analysis, smoothed the same way as the mono one.
+    _leftMelBankOutput = std::make_shared<ExpFilter>(0.0f, 0.70f, 0.90f, false, FILTER_SIZE);
+    _rightMelBankOutput = std::make_shared<ExpFilter>(0.0f, 0.70f, 0.90f, false, FILTER_SIZE);
+
+    // Initialize the input volume filter with an initial value of -90.0 dB, and both decay and rise factors set to 0.99.
+    // This filter will smooth the volume input over time to avoid abrupt changes.
+    // It is initially enabled (true), and the size is set to 1 (representing a single value).
+    _inVolFilter = std::make_shared<ExpFilter>(-90.0f, 0.99f, 0.99f, true, 1u);
+    LOGD("Input volume filter initialized with high smoothing factors (0.99) for decay and rise.");
+
+    // Initialize the DSP processor with the given FFT size, hop size, filter size, sample rate, and frequency range.
+    // The DSP processor will process incoming audio data and extract features like frequency bins.
+    _dspProcessor = makeFloatDspProcessor();
+    LOGD("DSP Processor initialized with FFT_SIZE = %i, HOP_SIZE = %i, and sample rate = %i Hz.", FFT_SIZE, HOP_SIZE, sampleRate);
+
+    // The LED frame holds `BYTES_PER_LED` bytes per LED, the device adds the protocol header when sending.
+    resizeLeds(numLeds);
+}
+
+/**
+ * Processes one buffer of interleaved audio: level measurement, silence detection, analysis and rendering.
+ *
+ * @param audioData The interleaved samples, int16 with the fixed point analysis, float otherwise.
+ * @param numFrames The number of frames in the buffer.
+ * @param isMonoOnly true to analyse the mix even when stereo analysis is selected.
+ * @return true if the LED frame must be sent, false if nothing changed since the last sent frame.
+ */
+bool AudioPipeline::process(void* audioData, int32_t numFrames, bool isMonoOnly) {
+    auto vol = measureLevel(audioData, numFrames);
+    vol=std::max<float>(0,std::min<float>(1,vol));
+    _inVolFilter->update(vol);
+
+    // While silent, skip the DSP and only send a blank frame on entry and as periodic keepalive.
+    const SilenceDetector::Action action = _silenceDetector.update(_inVolFilter->value, numFrames);
+    bool shouldSend = action != SilenceDetector::Action::Idle;
+
+    if(action == SilenceDetector::Action::Analyze){
+
+        const bool isStereo = _isStereoAnalysis && !isMonoOnly;
+        // Counted as a difference, the processor is replaced when switching to or from fixed point.
+        const uint64_t hopCount = _dspProcessor->getAnalyzedHopCount();
+        if (isStereo) {
+            _dspProcessor->doStereoMelBank(audioData, numFrames, _melBankOutput, _leftMelBankOutput, _rightMelBankOutput);
+        } else {
+            _dspProcessor->doMelBank(audioData, numFrames, _melBankOutput);
+        }
+        _analyzedHops += _dspProcessor->getAnalyzedHopCount() - hopCount;
+
+        // The analysis always runs, rendering and sending can be skipped to lower the output rate.
+        _frameCounter = (_frameCounter + 1u) % _frameDivider;
+        shouldSend = 0u == _frameCounter;
+        if (shouldSend) {
+            if (_logSpectrum) {
+                renderLogSpectrum();
+            } else {
+                renderLeds(isStereo);
+            }
+        }
+
+    } else if (shouldSend) {
+         std::fill(_ledData.begin(),_ledData.end(),0u);
+    }
+    return shouldSend;
+}
+
+/**
+ * Measures the input level of a buffer, 0 dB SPL mapped to 1.0 and -100 dB to 0.0.
+ *
+ * @param audioData The interleaved samples, int16 with the fixed point analysis, float otherwise.
+ * @param numFrames The number of frames in the buffer.
+ * @return The unclamped level.
+ */
+float AudioPipeline::measureLevel(const void* audioData, int32_t numFrames) const {
+    const size_t count = static_cast<size_t>(numFrames) * _channelCount;
+    if (_isFixedPoint) {
+        // Same level as aubio_db_spl, from the int16 samples.
+        const auto* samples = static_cast<const int16_t*>(audioData);
+        int64_t energy = 0;
+        for (size_t i = 0; i < count; i++) {
+            energy += static_cast<int32_t>(samples[i]) * samples[i];
+        }
+        const float meanSquare = static_cast<float>(energy) / (1073741824.0f * static_cast<float>(std::max<size_t>(count, 1u)));
+        return 1 + 10.0f * std::log10(meanSquare) / 100;
+    }
+
+    // Wrap the buffer without allocating, aubio only reads it.
+    fvec_t samp = {static_cast<uint_t>(count), static_cast<smpl_t*>(const_cast<void*>(audioData))};
+    return 1+ aubio_db_spl(&samp)/100;
+}
+
+/**
+ * Applies the savings of a quality level, see LoadGovernor::Level.
+ *
+ * @param level The new quality level.
+ */
+void AudioPipeline::applyQualityLevel(uint32_t level) {
+    _frameDivider = level >= LoadGovernor::HalfFps ? 2u : 1u;
+    _frameCounter = 0u;
+    _dspProcessor->setHopDecimation(level >= LoadGovernor::HalfHop ? 2u : 1u);
+    _dspProcessor->setReducedBands(level >= LoadGovernor::Minimal);
+}
+
+/**
+ * Restarts silence detection and the hop count, to be called before the audio starts flowing.
+ */
+void AudioPipeline::reset() {
+    _silenceDetector.reset();
+    _analyzedHops = 0u;
+}
+
+/**
+ * Selects between the float analysis and the fixed point one, which takes int16 input.
+ * Replaces the DSP processor, so its analysis state starts over.
+ *
+ * @param isFixedPoint true for the fixed point analysis, false for the float one.
+ */
+void AudioPipeline::setFixedPointAnalysis(bool isFixedPoint) {
+    if (isFixedPoint == _isFixedPoint) return;
+
+    _isFixedPoint = isFixedPoint;
+    if (isFixedPoint) {
+        _dspProcessor = std::make_unique<FixedPointDspProcessor>(FFT_SIZE, HOP_SIZE, FILTER_SIZE, _sampleRate, MIN_FREQ_HZ,
+                                                                 MAX_FREQ_HZ, _channelCount);
+    } else {
+        _dspProcessor = makeFloatDspProcessor();
+    }
+    // Rebuilt, the multi-resolution float analysis takes the bass bands from its long FFT.
+    setLogSpectrumBands(_logSpectrumBands);
+    LOGD("DSP Processor switched to %s analysis.", isFixedPoint ? "fixed point" : "float");
+}
+
+/**
+ * Renders a log-frequency spectrum across the whole strip instead of the Mel bands, for strips too long
+ * for FILTER_SIZE bands. The spectrum comes from the same FFT as the Mel bands, at a few operations per band,
+ * see LogSpectrum. Stereo analysis renders the spectrum of the mid channel. The multi-resolution analysis computes
+ * the bands below MULTI_RES_CROSSOVER_HZ from its long FFT instead, which resolves more of them.
+ * Allocates, must be called while the audio isn't flowing, like setFixedPointAnalysis().
+ *
+ * @param bandCount The number of bands, LOG_SPECTRUM_MIN_BANDS to LOG_SPECTRUM_MAX_BANDS, 0 to render the Mel bands.
+ * Capped to the bands the FFT resolves, see LogSpectrum::getResolvableBandCount().
+ */
+void AudioPipeline::setLogSpectrumBands(size_t bandCount) {
+    _logSpectrumBands = bandCount;
+    if (0u == bandCount) {
+        _logSpectrum.reset();
+        _logSpectrumOutput.reset();
+    } else if (_isMultiResolution && !_isFixedPoint) {
+        _logSpectrum = std::make_shared<LogSpectrum>(FFT_SIZE, static_cast<float>(_sampleRate), LOG_SPECTRUM_MIN_FREQ_HZ,
+                                                     LOG_SPECTRUM_MAX_FREQ_HZ, bandCount, FFT_SIZE,
+                                                     static_cast<float>(_sampleRate) / MULTI_RES_DECIMATION,
+                                                     MULTI_RES_CROSSOVER_HZ);
+    } else {
+        _logSpectrum = std::make_shared<LogSpectrum>(FFT_SIZE, static_cast<float>(_sampleRate), LOG_SPECTRUM_MIN_FREQ_HZ,
+                                                     LOG_SPECTRUM_MAX_FREQ_HZ, bandCount);
+    }
+    if (_logSpectrum) {
+        // Slower decay than the Mel bands, so the peaks of single bands stay visible.
+        _logSpectrumOutput = std::make_shared<ExpFilter>(0.0f, 0.50f, 0.90f, false, _logSpectrum->getBandCount());
+        LOGD("Log spectrum of %zu bands, %zu of them grouped, %zu from the long FFT.", _logSpectrum->getBandCount(),
+             _logSpectrum->getGroupedBandCount(), _logSpectrum->getFineBandCount());
+    }
+    _dspProcessor->setLogSpectrum(_logSpectrum, _logSpectrumOutput);
+}
+
+/**
+ * Selects the multi-resolution float analysis: a long FFT of the decimated input for the bands below
+ * MULTI_RES_CROSSOVER_HZ, which lowers the first of its Mel bands to MULTI_RES_MIN_FREQ_HZ, and a short FFT at the
+ * full rate for the high bands and the onsets. Replaces the float DSP processor, so its analysis state starts over.
+ * The fixed point analysis, and the stereo analysis of a stereo input, keep a single FFT.
+ *
+ * @param isMultiResolution true for the multi-resolution analysis, false for the single FFT one.
+ */
+void AudioPipeline::setMultiResolutionAnalysis(bool isMultiResolution) {
+    if (isMultiResolution == _isMultiResolution) return;
+
+    _isMultiResolution = isMultiResolution;
+    if (!_isFixedPoint) {
+        _dspProcessor = makeFloatDspProcessor();
+        setLogSpectrumBands(_logSpectrumBands);
+    }
+    LOGD("DSP Processor switched to %s analysis.", isMultiResolution ? "multi-resolution" : "single FFT");
+}
+
+/**
+ * Creates the float DSP processor: the multi-resolution one when selected, else the compile time specialized one
+ * when a preset matches the sample rate, AubioDspProcessor otherwise.
+ *
+ * @return The new processor.
+ */
+std::unique_ptr<IDspProcessor> AudioPipeline::makeFloatDspProcessor() const {
+    if (_isMultiResolution) {
+        // The stereo analysis keeps the single FFT bands from MIN_FREQ_HZ.
+        return std::make_unique<AubioDspProcessor>(FFT_SIZE, HOP_SIZE, FILTER_SIZE, _sampleRate, MIN_FREQ_HZ,
+                                                   MAX_FREQ_HZ, _channelCount, true, MULTI_RES_MIN_FREQ_HZ);
+    }
+    std::unique_ptr<IDspProcessor> processor = makeStaticDspProcessor(FFT_SIZE, HOP_SIZE, FILTER_SIZE, _sampleRate,
+                                                                      MIN_FREQ_HZ, MAX_FREQ_HZ, _channelCount);
+    if (!processor) {
+        processor = std::make_unique<AubioDspProcessor>(FFT_SIZE, HOP_SIZE, FILTER_SIZE, _sampleRate, MIN_FREQ_HZ,
+                                                        MAX_FREQ_HZ, _channelCount);
+    }
+    return processor;
+}
+
+/**
+ * Resizes the LED frame.
+ *
+ * @param numLeds The number of LEDs to render.
+ */
+void AudioPipeline::resizeLeds(size_t numLeds) {
+    _ledData.resize(numLeds*BYTES_PER_LED,0);
+}
+
+/**
+ * Renders the smoothed mel filter banks into the LED frame.
+ *
+ * @param isStereo True to render the left spectrum on the first half of the strip and the right one on the second half.
+ */
+void AudioPipeline::renderLeds(bool isStereo) {
+    auto calMelAvrg = [](std::vector<float>::iterator start, uint32_t size)->uint8_t {
+       float val =  (std::accumulate(start,start+(size-1),0.0f))/size;
+        return (uint8_t)val;
+    };
+
+    // Fills LEDs [first, last) of the strip with the colour of the given mel filter bank.
+    auto fillLeds = [&](const std::shared_ptr<ExpFilter>& melBank, size_t first, size_t last) {
+        uint8_t r,g,b;
+
+        r=calMelAvrg(melBank->valueVec.begin(), 4u);
+        g=calMelAvrg(melBank->valueVec.begin() + 4, 4u);
+        b=calMelAvrg(melBank->valueVec.begin() + 6, 4u);
+
+        for(size_t i = first * BYTES_PER_LED; i < last * BYTES_PER_LED; i+=3){
+            _ledData[i]=r;
+            _ledData[i+1]=g;
+            _ledData[i+2]=b;
+        }
+    };
+
+    const size_t numLeds = _ledData.size() / BYTES_PER_LED;
+    if (isStereo) {
+        // Left spectrum on the first half of the strip, right spectrum on the second half.
+        fillLeds(_leftMelBankOutput, 0, numLeds / 2);
+        fillLeds(_rightMelBankOutput, numLeds / 2, numLeds);
+    } else {
+        fillLeds(_melBankOutput, 0, numLeds);
+    }
+}
+
+/**
+ * Renders the smoothed log-frequency spectrum into the LED frame, lowest band first. Each LED shows the loudest
+ * of the bands it covers, coloured from red for the bass to blue for the highs.
+ */
+void AudioPipeline::renderLogSpectrum() {
+    const std::vector<float>& levels = _logSpectrumOutput->valueVec;
+    const size_t bands = levels.size();
+    const size_t numLeds = _ledData.size() / BYTES_PER_LED;
+
+    for (size_t led = 0; led < numLeds; led++) {
+        const size_t first = led * bands / numLeds;
+        const size_t end = std::max((led + 1u) * bands / numLeds, first + 1u);
+        const float level = *std::max_element(levels.begin() + first, levels.begin() + end);
+
+        const float position = static_cast<float>(led) / static_cast<float>(std::max<size_t>(numLeds - 1u, 1u));
+        const float brightness = 255.0f * level;
+        uint8_t* rgb = _ledData.data() + led * BYTES_PER_LED;
+        rgb[0] = static_cast<uint8_t>(brightness * std::max(1.0f - 2.0f * position, 0.0f));
+        rgb[1] = static_cast<uint8_t>(brightness * (1.0f - std::fabs(2.0f * position - 1.0f)));
+        rgb[2] = static_cast<uint8_t>(brightness * std::max(2.0f * position - 1.0f, 0.0f));
+    }
+}
@@ -0,0 +1,112 @@
+#ifndef LEDFX_AUDIOPIPELINE_H
+#define LEDFX_AUDIOPIPELINE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "ExpFilter.h"
+#include "IDspProcessor.h"
+#include "LogSpectrum.h"
+#include "SilenceDetector.h"
+
+#define SAMPLE_RATE 44100u
+#define FFT_SIZE 512u
+#define HOP_SIZE 192U  // same as frame size.
+#define FILTER_SIZE 24u
+#define MIN_FREQ_HZ 200u
+#define MAX_FREQ_HZ 4000u
+#define MULTI_RES_MIN_FREQ_HZ 50u  // Lowest band of the long and short Mel banks, the long FFT resolves the bass.
+#define BYTES_PER_LED 3u
+#define SILENCE_ENTER_LEVEL 0.70f  // Input level below which audio starts counting as silence.
+#define SILENCE_EXIT_LEVEL 0.72f   // Input level at which a silent input resumes.
+#define SILENCE_HOLD_MS 250u       // Time below SILENCE_ENTER_LEVEL before going idle.
+#define SILENCE_KEEPALIVE_MS 500u  // Blank frame interval while idle, below the 1 second WLED timeout.
+
+/**
+ * @brief Audio to LED pipeline, independent from the audio stream.
+ * Measures the input level, skips silent input, runs the DSP processor, smooths its Mel output
+ * and renders the LED frame. The engine drives it from the Oboe callback, the offline renderer from a file,
+ * so both produce the same frames for the same audio.
+ * process() and the setters must be called from the same thread, except setStereoAnalysis().
+ */
+class AudioPipeline {
+public:
+    AudioPipeline(int32_t sampleRate, size_t channelCount, size_t numLeds);
+
+    bool process(void* audioData, int32_t numFrames, bool isMonoOnly);
+
+    void applyQualityLevel(uint32_t level);
+
+    void reset();
+
+    void setStereoAnalysis(bool isStereo) { _isStereoAnalysis = isStereo; }
+
+    void setFixedPointAnalysis(bool isFixedPoint);
+
+    bool isFixedPointAnalysis() const { return _isFixedPoint; }
+
+    void setMultiResolutionAnalysis(bool isMultiResolution);
+
+    bool isMultiResolutionAnalysis() const { return _isMultiResolution; }
+
+    void setLogSpectrumBands(size_t bandCount);
+
+    /**
+     * @return the number of bands of the log-frequency spectrum, 0 when the Mel bands are rendered instead.
+     */
+    size_t getLogSpectrumBands() const { return _logSpectrum ? _logSpectrum->getBandCount() : 0u; }
+
+    void resizeLeds(size_t numLeds);
+
+    /**
+     * Swaps in a frame allocated elsewhere, so the LED count can change without allocating on the audio thread.
+     * @param ledData The new frame of RGB bytes. Receives the previous frame.
+     */
+    void swapLedData(std::vector<uint8_t>& ledData) { _ledData.swap(ledData); }
+
+    /**
+     * @return the rendered frame, BYTES_PER_LED RGB bytes per LED.
+     */
+    std::vector<uint8_t>& getLedData() { return _ledData; }
+
+    const AudioFeatures& getFeatures() const { return _dspProcessor->getFeatures(); }
+
+    bool isSilent() const { return _silenceDetector.isSilent(); }
+
+    /**
+     * @return the number of hops whose spectrum was computed since reset(), silent input and hops skipped by
+     * the decimation excluded.
+     */
+    uint64_t getAnalyzedHops() const { return _analyzedHops; }
+
+private:
+    const int32_t     _sampleRate;
+    const size_t      _channelCount;
+    bool              _isFixedPoint = false;  // int16 input and fixed point DSP, float otherwise.
+    bool              _isMultiResolution = false;  // Long and short FFT float analysis.
+    std::atomic<bool> _isStereoAnalysis{false};
+
+    std::unique_ptr<IDspProcessor> _dspProcessor;
+    SilenceDetector   _silenceDetector;
+    uint32_t          _frameDivider = 1u;  // Render once every _frameDivider analysed buffers.
+    uint32_t          _frameCounter = 0u;
+    uint64_t          _analyzedHops = 0u;
+
+    std::shared_ptr<ExpFilter> _inVolFilter;
+    std::shared_ptr<ExpFilter> _melBankOutput;
+    std::shared_ptr<ExpFilter> _leftMelBankOutput;
+    std::shared_ptr<ExpFilter> _rightMelBankOutput;
+    size_t            _logSpectrumBands = 0u;  // Requested band count, the spectrum is rebuilt with the analysis.
+    std::shared_ptr<LogSpectrum> _logSpectrum;  // Rendered instead of the Mel bands when set.
+    std::shared_ptr<ExpFilter> _logSpectrumOutput;
+    std::vector<uint8_t> _ledData;
+
+    std::unique_ptr<IDspProcessor> makeFloatDspProcessor() const;
+    float measureLevel(const void* audioData, int32_t numFrames) const;
+    void renderLeds(bool isStereo);
+    void renderLogSpectrum();
+};
+
+
+#endif //LEDFX_AUDIOPIPELINE_H
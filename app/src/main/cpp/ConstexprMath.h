@@ -0,0 +1,71 @@
+#ifndef LEDFX_CONSTEXPRMATH_H
+#define LEDFX_CONSTEXPRMATH_H
+
+#include <cstdint>
+
+/**
+ * Math functions usable in constant expressions, the <cmath> ones are not constexpr before C++26.
+ * Only meant for generating tables at compile time, they trade speed for double precision.
+ */
+constexpr double CONSTEXPR_PI = 3.14159265358979323846;
+constexpr double CONSTEXPR_LN2 = 0.69314718055994530942;
+
+/**
+ * Cosine, the angle is reduced to [-pi, pi] before its Taylor series.
+ */
+constexpr double constexprCos(double x) {
+    const double turns = x / (2.0 * CONSTEXPR_PI);
+    x -= 2.0 * CONSTEXPR_PI * static_cast<double>(static_cast<int64_t>(turns + (turns >= 0.0 ? 0.5 : -0.5)));
+    double term = 1.0;
+    double sum = 1.0;
+    for (int n = 1; n < 30; n++) {
+        term *= -x * x / static_cast<double>((2 * n - 1) * (2 * n));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double constexprSin(const double x) {
+    return constexprCos(x - CONSTEXPR_PI / 2.0);
+}
+
+/**
+ * Exponential, exp(x) = 2^k * exp(r) with |r| <= ln(2) / 2.
+ */
+constexpr double constexprExp(const double x) {
+    const double k = static_cast<double>(static_cast<int64_t>(x / CONSTEXPR_LN2 + (x >= 0.0 ? 0.5 : -0.5)));
+    const double r = x - k * CONSTEXPR_LN2;
+    double term = 1.0;
+    double sum = 1.0;
+    for (int n = 1; n < 25; n++) {
+        term *= r / static_cast<double>(n);
+        sum += term;
+    }
+    for (int64_t i = 0; i < static_cast<int64_t>(k); i++) sum *= 2.0;
+    for (int64_t i = 0; i > static_cast<int64_t>(k); i--) sum /= 2.0;
+    return sum;
+}
+
+/**
+ * Natural logarithm of a positive value, log(x) = e * ln(2) + 2 * atanh((m - 1) / (m + 1)) with x = m * 2^e.
+ */
+constexpr double constexprLog(double x) {
+    int e = 0;
+    while (x > 1.5) { x /= 2.0; e++; }
+    while (x < 0.75) { x *= 2.0; e--; }
+    const double z = (x - 1.0) / (x + 1.0);
+    double power = z;
+    double sum = 0.0;
+    for (int n = 0; n < 30; n++) {
+        sum += power / static_cast<double>(2 * n + 1);
+        power *= z * z;
+    }
+    return static_cast<double>(e) * CONSTEXPR_LN2 + 2.0 * sum;
+}
+
+constexpr double constexprPow(const double base, const double exponent) {
+    return constexprExp(exponent * constexprLog(base));
+}
+
+
+#endif //LEDFX_CONSTEXPRMATH_H
@@ -0,0 +1,48 @@
+#include "EngineStats.h"
+
+/**
+ * Publishes the values of a callback. Wait free, the writer never waits for readers.
+ *
+ * @param values The counters kept by the audio thread.
+ */
+void EngineStats::publish(const Values& values) {
+    const uint32_t sequence = _sequence.load(std::memory_order_relaxed);
+    _sequence.store(sequence + 1u, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    _callbacks.store(values.callbacks, std::memory_order_relaxed);
+    _analyzedHops.store(values.analyzedHops, std::memory_order_relaxed);
+    _renderedFrames.store(values.renderedFrames, std::memory_order_relaxed);
+    _sentFrames.store(values.sentFrames, std::memory_order_relaxed);
+    _droppedFrames.store(values.droppedFrames, std::memory_order_relaxed);
+    _sendFailures.store(values.sendFailures, std::memory_order_relaxed);
+    _xRunCount.store(values.xRunCount, std::memory_order_relaxed);
+    _outputFps.store(values.outputFps, std::memory_order_relaxed);
+    _isSilent.store(values.isSilent, std::memory_order_relaxed);
+
+    _sequence.store(sequence + 2u, std::memory_order_release);
+}
+
+/**
+ * Reads a consistent copy of the last published values, retrying while a publish() is in progress.
+ *
+ * @return The values of a single callback.
+ */
+EngineStats::Values EngineStats::read() const {
+    Values values;
+    uint32_t sequence;
+    do {
+        sequence = _sequence.load(std::memory_order_acquire);
+        values.callbacks = _callbacks.load(std::memory_order_relaxed);
+        values.analyzedHops = _analyzedHops.load(std::memory_order_relaxed);
+        values.renderedFrames = _renderedFrames.load(std::memory_order_relaxed);
+        values.sentFrames = _sentFrames.load(std::memory_order_relaxed);
+        values.droppedFrames = _droppedFrames.load(std::memory_order_relaxed);
+        values.sendFailures = _sendFailures.load(std::memory_order_relaxed);
+        values.xRunCount = _xRunCount.load(std::memory_order_relaxed);
+        values.outputFps = _outputFps.load(std::memory_order_relaxed);
+        values.isSilent = _isSilent.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((sequence & 1u) || sequence != _sequence.load(std::memory_order_relaxed));
+    return values;
+}
@@ -0,0 +1,45 @@
+#ifndef LEDFX_ENGINESTATS_H
+#define LEDFX_ENGINESTATS_H
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief Engine counters shared between the audio thread and the UI.
+ * The audio thread keeps its own Values and publishes them once per callback, the fields are relaxed atomics
+ * behind a sequence counter, so read() returns the values of a single callback without locking either side.
+ * publish() must only be called from one thread at a time, read() can be called from any thread.
+ */
+class EngineStats {
+public:
+    struct Values {
+        uint64_t callbacks = 0u;       // Audio callbacks processed.
+        uint64_t analyzedHops = 0u;    // Hops whose spectrum was computed, silence and decimated hops excluded.
+        uint64_t renderedFrames = 0u;  // LED frames produced by the pipeline, blank silence frames included.
+        uint64_t sentFrames = 0u;      // Rendered frames the device sent completely.
+        uint64_t droppedFrames = 0u;   // Rendered frames replaced before being sent, or that the device failed to send.
+        uint64_t sendFailures = 0u;    // Failed send() calls, a frame can take several packets.
+        int32_t  xRunCount = 0;        // XRuns of the current input stream, 0 if the API doesn't report them.
+        float    outputFps = 0.0f;     // Sent frames per second over the last second of audio.
+        bool     isSilent = false;     // The pipeline is idle on a silent input.
+    };
+
+    void publish(const Values& values);
+
+    Values read() const;
+
+private:
+    std::atomic<uint32_t> _sequence{0u};  // Odd while publish() is writing.
+    std::atomic<uint64_t> _callbacks{0u};
+    std::atomic<uint64_t> _analyzedHops{0u};
+    std::atomic<uint64_t> _renderedFrames{0u};
+    std::atomic<uint64_t> _sentFrames{0u};
+    std::atomic<uint64_t> _droppedFrames{0u};
+    std::atomic<uint64_t> _sendFailures{0u};
+    std::atomic<int32_t>  _xRunCount{0};
+    std::atomic<float>    _outputFps{0.0f};
+    std::atomic<bool>     _isSilent{false};
+};
+
+
+#endif //LEDFX_ENGINESTATS_H
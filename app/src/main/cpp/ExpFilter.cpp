@@ -16,7 +16,7 @@
  * @param size The size of the valueVec.
  */
 ExpFilter::ExpFilter(float val, float alphaDecay, float alphaRise, bool init, uint32_t size):
-_alphaDecay(alphaDecay), _alphaRise(alphaRise), value(val), _initialized(init), valueVec(size) {
+value(val), valueVec(size), _alphaDecay(alphaDecay), _alphaRise(alphaRise), _initialized(init) {
     assert(0.0 < _alphaDecay && _alphaDecay < 1.0 && "Invalid decay smoothing factor");
     assert(0.0 < _alphaRise && _alphaRise < 1.0 && "Invalid rise smoothing factor");
 }
@@ -6,6 +6,7 @@
 #define LEDFX_EXPFILTER_H
 
 #include <cassert>
+#include <cstdint>
 #include <vector>
 #include <algorithm>
 #include <numeric>
@@ -0,0 +1,440 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include "logging_macros.h"
+#include "FixedPointDspProcessor.h"
+#include "aubio.h"
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/**
+ * Converts a coefficient in [-2, 2) to Q30.
+ */
+static int32_t toQ30(const double value) {
+    return static_cast<int32_t>(std::lround(value * 1073741824.0));
+}
+
+/**
+ * Converts a value in [-1, 1] to Q31, 1.0 saturates to the largest Q31 value.
+ */
+static int32_t toQ31(const double value) {
+    return static_cast<int32_t>(std::max(-2147483648.0, std::min(std::round(value * 2147483648.0), 2147483647.0)));
+}
+
+/**
+ * Rounding Q31 multiplication, same result as vqrdmulhq_s32.
+ */
+static inline int32_t mulQ31(const int32_t a, const int32_t b) {
+    return static_cast<int32_t>((static_cast<int64_t>(a) * b + (INT64_C(1) << 30)) >> 31);
+}
+
+static inline int16_t saturate16(const int32_t value) {
+    return static_cast<int16_t>(std::max<int32_t>(INT16_MIN, std::min<int32_t>(value, INT16_MAX)));
+}
+
+/**
+ * Constructor for the FixedPointDspProcessor class.
+ * Precomputes the window, the FFT tables and the sparse Mel filter bank, nothing is allocated afterwards.
+ *
+ * @param winS The window size for the FFT, must be a power of two.
+ * @param hopS The hop size.
+ * @param filterS The number of filters in the Mel filter bank.
+ * @param sampleRate The sample rate of the audio.
+ * @param fMin The minimum frequency for the Mel filter bank.
+ * @param fMax The maximum frequency for the Mel filter bank.
+ * @param channelCount The number of interleaved channels in the audio data, 1 or 2.
+ */
+FixedPointDspProcessor::FixedPointDspProcessor(const size_t winS, const size_t hopS, const size_t filterS,
+                                               const float sampleRate, const float fMin, const float fMax,
+                                               const size_t channelCount) :
+        _winSize(winS), _hopSize(hopS), _channelCount(channelCount), _fftSize(static_cast<uint32_t>(winS / 2u)),
+        _hop(hopS), _frame(winS), _window(winS), _windowed(winS), _bitReverse(winS / 2u),
+        _re(winS / 2u), _im(winS / 2u), _power(winS / 2u + 1u), _magnitude(winS / 2u + 1u), _lastMagnitude(winS / 2u + 1u),
+        _bands(makeSparseBands(winS, filterS, sampleRate, fMin, fMax)),
+        _halfBands(makeSparseBands(winS, std::max<size_t>(filterS / 2u, 1u), sampleRate, fMin, fMax)),
+        _melOutput(filterS), _melReduced(std::max<size_t>(filterS / 2u, 1u)),
+        _onsetBeatTracker(hopS, sampleRate) {
+    assert(0u == (winS & (winS - 1u)) && winS >= 8u && "Window size must be a power of two");
+    assert((1u == channelCount || 2u == channelCount) && "Only mono and stereo input is supported.");
+
+    // Same pre-emphasis biquad as the float path.
+    _b0 = toQ30(1.00000285);
+    _b1 = toQ30(-1.93078064);
+    _b2 = toQ30(0.95054174);
+    _a1 = toQ30(-1.93078064);
+    _a2 = toQ30(0.95054459);
+
+    // Same definition as aubio's "hanning" window.
+    for (size_t i = 0; i < winS; i++) {
+        const double value = 0.5 - 0.5 * std::cos(2.0 * M_PI * static_cast<double>(i) / static_cast<double>(winS));
+        _window[i] = saturate16(static_cast<int32_t>(std::lround(value * 32768.0)));
+    }
+
+    uint32_t bits = 0u;
+    while ((1u << bits) < _fftSize) bits++;
+    for (uint32_t i = 0; i < _fftSize; i++) {
+        uint32_t reversed = 0u;
+        for (uint32_t b = 0; b < bits; b++) {
+            reversed |= ((i >> b) & 1u) << (bits - 1u - b);
+        }
+        _bitReverse[i] = static_cast<uint16_t>(reversed);
+    }
+
+    // Twiddles of each radix-2 stage, W = exp(-2*pi*i*j / (2 * half)) for j < half.
+    for (uint32_t half = 1u; half < _fftSize; half <<= 1u) {
+        for (uint32_t j = 0; j < half; j++) {
+            const double angle = -M_PI * static_cast<double>(j) / static_cast<double>(half);
+            _stageTwiddleRe.push_back(toQ31(std::cos(angle)));
+            _stageTwiddleIm.push_back(toQ31(std::sin(angle)));
+        }
+    }
+
+    // Twiddles of the split step recovering the winS real FFT from the winS / 2 complex one.
+    for (uint32_t k = 0; k <= _fftSize; k++) {
+        const double angle = -2.0 * M_PI * static_cast<double>(k) / static_cast<double>(winS);
+        _splitTwiddleRe.push_back(toQ31(std::cos(angle)));
+        _splitTwiddleIm.push_back(toQ31(std::sin(angle)));
+    }
+
+    LOGI("FixedPointDspProcessor initialized with window size: %zu, hop size: %zu, filter size: %zu, sample rate: %.2f, frequency range: [%.2f, %.2f], channels: %zu",
+         winS, hopS, filterS, sampleRate, fMin, fMax, channelCount);
+}
+
+/**
+ * Builds the sparse Q15 version of the Mel filter bank used by the float path.
+ *
+ * @param winS The window size for the FFT.
+ * @param filterS The number of filters in the Mel filter bank.
+ * @param sampleRate The sample rate of the audio.
+ * @param fMin The minimum frequency for the Mel filter bank.
+ * @param fMax The maximum frequency for the Mel filter bank.
+ * @return The non zero coefficients of each band.
+ */
+std::vector<FixedPointDspProcessor::SparseBand> FixedPointDspProcessor::makeSparseBands(
+        const size_t winS, const size_t filterS, const float sampleRate, const float fMin, const float fMax) {
+    aubio_filterbank_t* filterBank = new_aubio_filterbank(filterS, winS);
+    aubio_filterbank_set_norm(filterBank, 1.0f);
+    aubio_filterbank_set_mel_coeffs(filterBank, sampleRate, fMin, fMax);
+    const fmat_t* coeffs = aubio_filterbank_get_coeffs(filterBank);
+
+    std::vector<SparseBand> bands(filterS);
+    for (uint_t j = 0; j < coeffs->height; j++) {
+        const smpl_t* row = coeffs->data[j];
+        uint_t first = 0u;
+        while (first < coeffs->length && row[first] <= 0.0f) first++;
+        uint_t last = coeffs->length;
+        while (last > first && row[last - 1u] <= 0.0f) last--;
+
+        SparseBand& band = bands[j];
+        band.firstBin = first;
+        const float maxCoeff = first < last ? *std::max_element(row + first, row + last) : 0.0f;
+        band.scale = maxCoeff / 32767.0f;
+        for (uint_t k = first; k < last; k++) {
+            band.coeffs.push_back(static_cast<int16_t>(std::lround(row[k] / maxCoeff * 32767.0f)));
+        }
+    }
+
+    del_aubio_filterbank(filterBank);
+    return bands;
+}
+
+/**
+ * Applies the Mel-Bank filtering process on the provided int16 audio data.
+ * The interleaved input is down-mixed to mono and collected into hops, every complete hop
+ * is analysed in fixed point and the Mel energies are passed to the given ExpFilter object.
+ *
+ * @param audioData Pointer to the interleaved int16 audio data buffer.
+ * @param numFrames The number of frames in the audio data buffer.
+ * @param melBank A shared pointer to an ExpFilter object that will be updated with Mel output data.
+ */
+void FixedPointDspProcessor::doMelBank(void *audioData, const size_t numFrames, std::shared_ptr<ExpFilter> melBank) {
+    const auto* in = static_cast<const int16_t*>(audioData);
+    _features.isOnset = false;
+    _features.isBeat = false;
+
+    size_t done = 0u;
+    while (done < numFrames) {
+        const size_t count = std::min(numFrames - done, _hopSize - _hopFill);
+        int16_t* out = _hop.data() + _hopFill;
+        if (2u == _channelCount) {
+            const int16_t* stereo = in + done * 2u;
+            size_t i = 0;
+#if defined(__ARM_NEON)
+            for (; i + 8 <= count; i += 8) {
+                int16x8x2_t lr = vld2q_s16(stereo + 2 * i);
+                vst1q_s16(out + i, vhaddq_s16(lr.val[0], lr.val[1]));
+            }
+#endif
+            for (; i < count; i++) {
+                out[i] = static_cast<int16_t>((stereo[2 * i] + stereo[2 * i + 1]) >> 1);
+            }
+        } else {
+            std::copy(in + done, in + done + count, out);
+        }
+        _hopFill += count;
+        done += count;
+
+        if (_hopFill == _hopSize) {
+            analyzeHop(melBank);
+            _hopFill = 0u;
+        }
+    }
+}
+
+/**
+ * Stereo analysis is not available in fixed point, the mono analysis is mirrored on both channels.
+ *
+ * @param audioData Pointer to the interleaved int16 audio data buffer.
+ * @param numFrames The number of frames in the audio data buffer.
+ * @param melBank A shared pointer to an ExpFilter object that will be updated with the Mel output data.
+ * @param leftMelBank A shared pointer to an ExpFilter object, set to the smoothed mono Mel output.
+ * @param rightMelBank A shared pointer to an ExpFilter object, set to the smoothed mono Mel output.
+ */
+void FixedPointDspProcessor::doStereoMelBank(void *audioData, const size_t numFrames, std::shared_ptr<ExpFilter> melBank,
+                                             std::shared_ptr<ExpFilter> leftMelBank, std::shared_ptr<ExpFilter> rightMelBank) {
+    doMelBank(audioData, numFrames, melBank);
+    leftMelBank->valueVec = melBank->valueVec;
+    rightMelBank->valueVec = melBank->valueVec;
+}
+
+/**
+ * Analyses one complete mono hop held in _hop.
+ *
+ * @param melBank The ExpFilter to update with the Mel output data.
+ */
+void FixedPointDspProcessor::analyzeHop(const std::shared_ptr<ExpFilter>& melBank) {
+    preEmphasis();
+
+    std::copy(_frame.begin() + _hopSize, _frame.end(), _frame.begin());
+    std::copy(_hop.begin(), _hop.end(), _frame.end() - _hopSize);
+
+    const bool isDue = 0u == _hopCounter;
+    _hopCounter = (_hopCounter + 1u) % _hopDecimation;
+    if (!isDue) {
+        // Hold the last detection value so the beat tracker keeps its timing.
+        _onsetBeatTracker.hold(_features);
+        return;
+    }
+    _analyzedHopCount++;
+
+    computePowerSpectrum();
+
+    if (_reducedBands) {
+        projectMel(_halfBands, _melReduced);
+        for (size_t i = 0; i < _melOutput.size(); i++) {
+            _melOutput[i] = _melReduced[std::min(i / 2u, _melReduced.size() - 1u)];
+        }
+    } else {
+        projectMel(_bands, _melOutput);
+    }
+    melBank->update(_melOutput.data(), _melOutput.size());
+
+    _onsetBeatTracker.process(spectralFlux(), _features);
+    computeLogSpectrum();
+}
+
+/**
+ * Runs the pre-emphasis biquad in place on _hop, Direct Form I with Q30 coefficients and a Q23 state,
+ * so the nearly cancelling poles and zeros keep their precision.
+ */
+void FixedPointDspProcessor::preEmphasis() {
+    for (int16_t& sample : _hop) {
+        const int32_t x = static_cast<int32_t>(sample) * 256;
+        const int64_t acc = static_cast<int64_t>(_b0) * x + static_cast<int64_t>(_b1) * _x1
+                + static_cast<int64_t>(_b2) * _x2 - static_cast<int64_t>(_a1) * _y1
+                - static_cast<int64_t>(_a2) * _y2;
+        const auto y = static_cast<int32_t>(acc >> 30);
+        _x2 = _x1;
+        _x1 = x;
+        _y2 = _y1;
+        _y1 = y;
+        sample = saturate16((y + 128) >> 8);
+    }
+}
+
+/**
+ * Windows the analysis frame and computes the squared magnitude of its real FFT.
+ * The winS real samples are packed as winS / 2 complex ones (even samples in the real part,
+ * odd ones in the imaginary part), transformed, then split back into the winS / 2 + 1 bins of the real FFT.
+ * Twice the spectrum is kept to avoid a rounding shift, the Q15 input leaves enough headroom in int32.
+ */
+void FixedPointDspProcessor::computePowerSpectrum() {
+    size_t i = 0;
+#if defined(__ARM_NEON)
+    for (; i + 8 <= _winSize; i += 8) {
+        vst1q_s16(&_windowed[i], vqrdmulhq_s16(vld1q_s16(&_frame[i]), vld1q_s16(&_window[i])));
+    }
+#endif
+    for (; i < _winSize; i++) {
+        _windowed[i] = saturate16((static_cast<int32_t>(_frame[i]) * _window[i] + (1 << 14)) >> 15);
+    }
+
+    for (uint32_t n = 0; n < _fftSize; n++) {
+        const uint16_t r = _bitReverse[n];
+        _re[r] = _windowed[2u * n];
+        _im[r] = _windowed[2u * n + 1u];
+    }
+
+    complexFft();
+
+    // 2X[k] = (Z[k] + conj(Z[M - k])) - i * W^k * (Z[k] - conj(Z[M - k]))
+    for (uint32_t k = 0; k <= _fftSize; k++) {
+        const uint32_t a = k % _fftSize;
+        const uint32_t b = (_fftSize - k) % _fftSize;
+        const int32_t evenRe = _re[a] + _re[b];
+        const int32_t evenIm = _im[a] - _im[b];
+        const int32_t oddRe = _im[a] + _im[b];
+        const int32_t oddIm = _re[b] - _re[a];
+        const int32_t wr = _splitTwiddleRe[k];
+        const int32_t wi = _splitTwiddleIm[k];
+        const int32_t xr = evenRe + mulQ31(oddRe, wr) - mulQ31(oddIm, wi);
+        const int32_t xi = evenIm + mulQ31(oddRe, wi) + mulQ31(oddIm, wr);
+
+        _power[k] = static_cast<int64_t>(xr) * xr + static_cast<int64_t>(xi) * xi;
+        // Alpha max plus beta min magnitude estimate, within 7% and good enough for the spectral flux.
+        const int32_t absRe = std::abs(xr);
+        const int32_t absIm = std::abs(xi);
+        _magnitude[k] = std::max(absRe, absIm) + (std::min(absRe, absIm) * 3) / 8;
+    }
+}
+
+/**
+ * In place radix-2 decimation in time FFT of _re and _im, which must already be in bit reversed order.
+ * Butterflies use rounding Q31 multiplications and saturating additions.
+ */
+void FixedPointDspProcessor::complexFft() {
+    int32_t* re = _re.data();
+    int32_t* im = _im.data();
+    size_t twiddleOffset = 0u;
+
+    for (uint32_t half = 1u; half < _fftSize; half <<= 1u) {
+        const int32_t* wr = _stageTwiddleRe.data() + twiddleOffset;
+        const int32_t* wi = _stageTwiddleIm.data() + twiddleOffset;
+
+        for (uint32_t start = 0; start < _fftSize; start += 2u * half) {
+            uint32_t j = 0;
+#if defined(__ARM_NEON)
+            for (; j + 4 <= half; j += 4) {
+                const uint32_t a = start + j;
+                const uint32_t b = a + half;
+                const int32x4_t br = vld1q_s32(re + b);
+                const int32x4_t bi = vld1q_s32(im + b);
+                const int32x4_t twr = vld1q_s32(wr + j);
+                const int32x4_t twi = vld1q_s32(wi + j);
+                const int32x4_t tr = vqsubq_s32(vqrdmulhq_s32(br, twr), vqrdmulhq_s32(bi, twi));
+                const int32x4_t ti = vqaddq_s32(vqrdmulhq_s32(br, twi), vqrdmulhq_s32(bi, twr));
+                const int32x4_t ar = vld1q_s32(re + a);
+                const int32x4_t ai = vld1q_s32(im + a);
+                vst1q_s32(re + b, vqsubq_s32(ar, tr));
+                vst1q_s32(im + b, vqsubq_s32(ai, ti));
+                vst1q_s32(re + a, vqaddq_s32(ar, tr));
+                vst1q_s32(im + a, vqaddq_s32(ai, ti));
+            }
+#endif
+            for (; j < half; j++) {
+                const uint32_t a = start + j;
+                const uint32_t b = a + half;
+                const int32_t tr = mulQ31(re[b], wr[j]) - mulQ31(im[b], wi[j]);
+                const int32_t ti = mulQ31(re[b], wi[j]) + mulQ31(im[b], wr[j]);
+                re[b] = re[a] - tr;
+                im[b] = im[a] - ti;
+                re[a] += tr;
+                im[a] += ti;
+            }
+        }
+        twiddleOffset += half;
+    }
+}
+
+/**
+ * Projects the power spectrum raised to the square (the magnitude to the 4th power, like the float path)
+ * on a sparse Mel filter bank. The power is normalized by a common block exponent so its square fits in Q31,
+ * the bands are accumulated in 64 bits and only the result is converted to float.
+ *
+ * @param bands The sparse filter bank.
+ * @param mel The output Mel energies, one per band.
+ */
+void FixedPointDspProcessor::projectMel(const std::vector<SparseBand>& bands, std::vector<float>& mel) {
+    const int64_t maxPower = *std::max_element(_power.begin(), _power.end());
+    int shift = 0;
+    while ((maxPower >> shift) >= (INT64_C(1) << 31)) shift++;
+
+    // |X|^4 = power^2 / 2^64 for the float spectrum of an input scaled by 1 / 32768, twice the spectrum being kept.
+    const float exponentScale = std::ldexp(1.0f, 2 * shift - 33);
+
+    for (size_t j = 0; j < bands.size(); j++) {
+        const SparseBand& band = bands[j];
+        int64_t acc = 0;
+        for (size_t c = 0; c < band.coeffs.size(); c++) {
+            const auto q = static_cast<uint64_t>(_power[band.firstBin + c] >> shift);
+            const auto square = static_cast<int64_t>((q * q) >> 31);
+            acc += band.coeffs[c] * square;
+        }
+        mel[j] = static_cast<float>(acc) * band.scale * exponentScale;
+    }
+}
+
+/**
+ * Computes the spectral flux of the current spectrum, the sum of all magnitude increases since the last one.
+ *
+ * @return The flux, in the same unit as the float path.
+ */
+float FixedPointDspProcessor::spectralFlux() {
+    int64_t flux = 0;
+    for (size_t k = 0; k < _magnitude.size(); k++) {
+        const int32_t diff = _magnitude[k] - _lastMagnitude[k];
+        if (diff > 0) flux += diff;
+    }
+    _lastMagnitude.swap(_magnitude);
+    return static_cast<float>(flux) / 65536.0f;
+}
+
+/**
+ * Only computes the spectrum once every few hops, the skipped hops still slide the analysis window.
+ * Must be called from the thread running the analysis.
+ *
+ * @param decimation 1 to analyse every hop, 2 to analyse every other hop and so on.
+ */
+void FixedPointDspProcessor::setHopDecimation(const uint32_t decimation) {
+    _hopDecimation = std::max<uint32_t>(decimation, 1u);
+    _hopCounter = 0u;
+}
+
+/**
+ * Switches between the full Mel filter bank and the one with half the bands.
+ * Must be called from the thread running the analysis.
+ *
+ * @param isReduced true to use half the bands.
+ */
+void FixedPointDspProcessor::setReducedBands(const bool isReduced) {
+    _reducedBands = isReduced;
+}
+
+/**
+ * Computes the log-frequency spectrum of _power, if one was set. The log spectrum works in float,
+ * so the power is converted to the one of the float path, |X|^2 = power / 2^32.
+ */
+void FixedPointDspProcessor::computeLogSpectrum() {
+    if (!_logSpectrum) return;
+
+    for (size_t k = 0; k < _power.size(); k++) {
+        _logPower[k] = static_cast<float>(_power[k]) * (1.0f / 4294967296.0f);
+    }
+    _logSpectrum->process(_logPower.data(), *_logLevels);
+}
+
+/**
+ * Starts or stops computing a log-frequency spectrum on every analysis hop.
+ * Must be called from the thread running the analysis, allocates.
+ *
+ * @param logSpectrum The band kernels, built for winS, nullptr to stop computing it.
+ * @param levels The ExpFilter to update with the band levels.
+ */
+void FixedPointDspProcessor::setLogSpectrum(std::shared_ptr<LogSpectrum> logSpectrum, std::shared_ptr<ExpFilter> levels) {
+    assert((!logSpectrum || logSpectrum->getBinCount() == _power.size()) && "Log spectrum built for another FFT size");
+    _logSpectrum = std::move(logSpectrum);
+    _logLevels = std::move(levels);
+    _logPower.resize(_logSpectrum ? _power.size() : 0u);
+}
@@ -0,0 +1,97 @@
+#ifndef LEDFX_FIXEDPOINTDSPPROCESSOR_H
+#define LEDFX_FIXEDPOINTDSPPROCESSOR_H
+
+#include <cstdint>
+#include <vector>
+#include "ExpFilter.h"
+#include "IDspProcessor.h"
+#include "OnsetBeatTracker.h"
+
+/**
+ * @brief Fixed point DSP processor working directly on int16 PCM.
+ * Pre-emphasis, windowing, FFT and Mel projection run in Q15/Q31 integer arithmetic
+ * (NEON saturating arithmetic where available), only the final Mel energies are converted to float.
+ * It mirrors the AubioDspProcessor float path: same pre-emphasis biquad, Hann window, FFT size,
+ * and Mel filter bank coefficients raised to the same power.
+ * Stereo input is always analysed as mono, doStereoMelBank mirrors the result on both channels.
+ */
+class FixedPointDspProcessor : public IDspProcessor {
+    FixedPointDspProcessor() = delete;
+
+    /**
+     * Non zero coefficients of one Mel band, normalized so the largest one is 1.0 in Q15.
+     */
+    struct SparseBand {
+        uint32_t firstBin = 0u;
+        std::vector<int16_t> coeffs;
+        float scale = 0.0f; // Value of a Q15 coefficient of 1.0.
+    };
+
+const size_t _winSize;
+const size_t _hopSize;
+const size_t _channelCount;
+const uint32_t _fftSize;       // Size of the complex FFT, half the window size.
+size_t _hopFill = 0u;
+uint32_t _hopDecimation = 1u;
+uint32_t _hopCounter = 0u;
+uint64_t _analyzedHopCount = 0u;  // Hops whose spectrum was computed.
+bool _reducedBands = false;
+
+// Pre-emphasis biquad, Q30 coefficients, Q23 state.
+int32_t _b0, _b1, _b2, _a1, _a2;
+int32_t _x1 = 0, _x2 = 0, _y1 = 0, _y2 = 0;
+
+std::vector<int16_t> _hop;         // Mono hop being collected.
+std::vector<int16_t> _frame;       // Sliding analysis window.
+std::vector<int16_t> _window;      // Hann window, Q15.
+std::vector<int16_t> _windowed;
+std::vector<uint16_t> _bitReverse;
+std::vector<int32_t> _stageTwiddleRe; // Q31 twiddles of each FFT stage, stored contiguously per stage.
+std::vector<int32_t> _stageTwiddleIm;
+std::vector<int32_t> _splitTwiddleRe; // Q31 twiddles of the real FFT split step.
+std::vector<int32_t> _splitTwiddleIm;
+std::vector<int32_t> _re;          // Complex FFT buffers, 16 bits of headroom over the Q15 input.
+std::vector<int32_t> _im;
+std::vector<int64_t> _power;       // Squared magnitude of twice the spectrum, winS / 2 + 1 bins.
+std::vector<int32_t> _magnitude;   // Approximate magnitude of twice the spectrum, for the spectral flux.
+std::vector<int32_t> _lastMagnitude;
+std::vector<SparseBand> _bands;
+std::vector<SparseBand> _halfBands;
+std::vector<float> _melOutput;
+std::vector<float> _melReduced;
+
+OnsetBeatTracker _onsetBeatTracker;
+AudioFeatures _features;
+
+// Optional log-frequency spectrum, computed from _power converted to the float scale.
+std::shared_ptr<LogSpectrum> _logSpectrum;
+std::shared_ptr<ExpFilter> _logLevels;
+std::vector<float> _logPower;
+
+static std::vector<SparseBand> makeSparseBands(const size_t winS, const size_t filterS, const float sampleRate,
+                                               const float fMin, const float fMax);
+void analyzeHop(const std::shared_ptr<ExpFilter>& melBank);
+void preEmphasis();
+void computePowerSpectrum();
+void complexFft();
+void projectMel(const std::vector<SparseBand>& bands, std::vector<float>& mel);
+float spectralFlux();
+void computeLogSpectrum();
+
+public:
+
+    FixedPointDspProcessor(const size_t winS, const size_t hopS, const size_t filterS, const float sampleRate,
+                           const float fMin, const float fMax, const size_t channelCount = 1u);
+
+    void doMelBank(void* audioData, const size_t numFrames, std::shared_ptr<ExpFilter> melBank) override;
+    void doStereoMelBank(void* audioData, const size_t numFrames, std::shared_ptr<ExpFilter> melBank,
+                         std::shared_ptr<ExpFilter> leftMelBank, std::shared_ptr<ExpFilter> rightMelBank) override;
+    const AudioFeatures& getFeatures() const override { return _features; }
+    void setHopDecimation(const uint32_t decimation) override;
+    uint64_t getAnalyzedHopCount() const override { return _analyzedHopCount; }
+    void setReducedBands(const bool isReduced) override;
+    void setLogSpectrum(std::shared_ptr<LogSpectrum> logSpectrum, std::shared_ptr<ExpFilter> levels) override;
+};
+
+
+#endif //LEDFX_FIXEDPOINTDSPPROCESSOR_H
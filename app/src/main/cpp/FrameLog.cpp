@@ -0,0 +1,452 @@
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "logging_macros.h"
+#include "FrameLog.h"
+
+namespace {
+
+enum RecordType : uint8_t {
+    Raw = 0,
+    Rle = 1,
+    Delta = 2
+};
+
+constexpr size_t kGrowBytes = 1u << 20;        // File and mapping growth step.
+constexpr size_t kMinDeltaGap = 4u;            // Unchanged bytes worth a new span header.
+constexpr size_t kMaxSpan = 0xFFFFu;
+constexpr size_t kPixelBytes = 3u;
+
+void put16(uint8_t* p, uint16_t v) { p[0] = v & 0xFFu; p[1] = v >> 8; }
+void put32(uint8_t* p, uint32_t v) { for (int i = 0; i < 4; i++) p[i] = (v >> (8 * i)) & 0xFFu; }
+void put64(uint8_t* p, uint64_t v) { for (int i = 0; i < 8; i++) p[i] = (v >> (8 * i)) & 0xFFu; }
+uint16_t get16(const uint8_t* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+uint32_t get32(const uint8_t* p) { uint32_t v = 0; for (int i = 3; i >= 0; i--) v = (v << 8) | p[i]; return v; }
+uint64_t get64(const uint8_t* p) { uint64_t v = 0; for (int i = 7; i >= 0; i--) v = (v << 8) | p[i]; return v; }
+
+/**
+ * Encodes runs of identical pixels.
+ * @return The payload size, or 0 if it would not be smaller than maxBytes.
+ */
+size_t encodeRle(const uint8_t* frame, size_t numBytes, uint8_t* out, size_t maxBytes) {
+    if (0u != numBytes % kPixelBytes) return 0u;
+    size_t o = 0u;
+    for (size_t i = 0; i < numBytes;) {
+        size_t count = 1u;
+        while (i + count * kPixelBytes < numBytes && count < kMaxSpan &&
+               0 == memcmp(frame + i, frame + i + count * kPixelBytes, kPixelBytes)) {
+            count++;
+        }
+        if (o + 2u + kPixelBytes >= maxBytes) return 0u;
+        put16(out + o, static_cast<uint16_t>(count));
+        memcpy(out + o + 2u, frame + i, kPixelBytes);
+        o += 2u + kPixelBytes;
+        i += count * kPixelBytes;
+    }
+    return o;
+}
+
+/**
+ * Encodes the spans that changed since the previous frame, unchanged gaps shorter than a span header are merged in.
+ * @return The payload size, or SIZE_MAX if it would not be smaller than maxBytes.
+ */
+size_t encodeDelta(const uint8_t* previous, const uint8_t* frame, size_t numBytes, uint8_t* out, size_t maxBytes) {
+    size_t o = 0u;
+    size_t pos = 0u;
+    while (true) {
+        size_t start = pos;
+        while (start < numBytes && previous[start] == frame[start]) start++;
+        if (start == numBytes) break;
+
+        size_t end = start + 1u;
+        while (end < numBytes) {
+            if (previous[end] != frame[end]) {
+                end++;
+                continue;
+            }
+            size_t gap = end;
+            while (gap < numBytes && gap - end < kMinDeltaGap && previous[gap] == frame[gap]) gap++;
+            if (gap - end >= kMinDeltaGap || gap == numBytes) break;
+            end = gap;
+        }
+
+        size_t skip = start - pos;
+        while (skip > kMaxSpan) {
+            if (o + 4u >= maxBytes) return SIZE_MAX;
+            put16(out + o, kMaxSpan);
+            put16(out + o + 2u, 0u);
+            o += 4u;
+            skip -= kMaxSpan;
+        }
+        while (start < end) {
+            const size_t length = std::min(end - start, kMaxSpan);
+            if (o + 4u + length >= maxBytes) return SIZE_MAX;
+            put16(out + o, static_cast<uint16_t>(skip));
+            put16(out + o + 2u, static_cast<uint16_t>(length));
+            memcpy(out + o + 4u, frame + start, length);
+            o += 4u + length;
+            start += length;
+            skip = 0u;
+        }
+        pos = end;
+    }
+    return o;
+}
+
+} // namespace
+
+FrameLogWriter::~FrameLogWriter() {
+    close();
+}
+
+/**
+ * Creates the log file, replacing any existing one, and maps its first chunk.
+ * Allocates all the encoding buffers, so append() doesn't allocate until the index outgrows its reservation.
+ *
+ * @param path The path of the log file.
+ * @param frameBytes The size of every frame, in bytes.
+ * @param keyframeInterval The number of frames between two key frames.
+ * @return true if the file is ready for appending.
+ */
+bool FrameLogWriter::open(const std::string& path, size_t frameBytes, uint32_t keyframeInterval) {
+    close();
+    if (0u == frameBytes || 0u == keyframeInterval) return false;
+
+    _fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (_fd < 0) {
+        LOGE("Failed to create frame log %s", path.c_str());
+        return false;
+    }
+
+    _frameBytes = frameBytes;
+    _keyframeInterval = keyframeInterval;
+    _frameCount = 0u;
+    _lastTimestampUs = 0u;
+    _size = FRAME_LOG_HEADER_BYTES;
+    _previous.assign(frameBytes, 0u);
+    _scratch.resize(frameBytes + FRAME_LOG_RECORD_BYTES);
+    _index.clear();
+    _index.reserve(4096u);
+
+    if (!reserve(0u)) {
+        close();
+        return false;
+    }
+    writeHeader(0u);
+    return true;
+}
+
+/**
+ * Maps enough of the file for numBytes more bytes, growing it by whole steps.
+ *
+ * @param numBytes The number of bytes about to be written after the current end.
+ * @return true if the mapping is large enough.
+ */
+bool FrameLogWriter::reserve(size_t numBytes) {
+    if (_map && _size + numBytes <= _mapSize) return true;
+
+    const size_t mapSize = ((_size + numBytes) / kGrowBytes + 1u) * kGrowBytes;
+    if (_map) munmap(_map, _mapSize);
+    _map = nullptr;
+
+    if (0 != ftruncate(_fd, static_cast<off_t>(mapSize))) {
+        LOGE("Failed to grow frame log to %zu bytes", mapSize);
+        return false;
+    }
+    void* map = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+    if (MAP_FAILED == map) {
+        LOGE("Failed to map frame log");
+        return false;
+    }
+    _map = static_cast<uint8_t*>(map);
+    _mapSize = mapSize;
+    return true;
+}
+
+void FrameLogWriter::writeHeader(uint64_t indexOffset) {
+    memcpy(_map, FRAME_LOG_MAGIC, 4u);
+    put32(_map + 4u, FRAME_LOG_VERSION);
+    put32(_map + 8u, static_cast<uint32_t>(_frameBytes));
+    put32(_map + 12u, _keyframeInterval);
+    put64(_map + 16u, _frameCount);
+    put64(_map + 24u, _lastTimestampUs);
+    put64(_map + 32u, indexOffset);
+}
+
+/**
+ * Appends a frame, as a key frame every key frame interval and otherwise as the smallest
+ * of its delta against the previous frame and its key frame encodings, RLE and raw.
+ *
+ * @param frame The frame bytes.
+ * @param numBytes The size of the frame, must match the one given to open().
+ * @param timestampUs The time of the frame since the start of the recording, not decreasing
+ * and less than 71 minutes after the previous frame.
+ * @return true if the frame was written.
+ */
+bool FrameLogWriter::append(const uint8_t* frame, size_t numBytes, uint64_t timestampUs) {
+    if (!isOpen() || !_map || numBytes != _frameBytes || timestampUs < _lastTimestampUs ||
+        timestampUs - _lastTimestampUs > UINT32_MAX) return false;
+    if (!reserve(FRAME_LOG_RECORD_BYTES + _frameBytes)) return false;
+
+    const bool isKeyframe = 0u == _frameCount % _keyframeInterval;
+    uint8_t* record = _map + _size;
+    uint8_t* payload = record + FRAME_LOG_RECORD_BYTES;
+    RecordType type = Raw;
+    size_t payloadBytes = _frameBytes;
+
+    // The delta goes to the scratch buffer, the RLE straight into the record and only when it is smaller than
+    // both the delta and the raw frame, so the smallest of the three ends up in the file.
+    const size_t deltaBytes = isKeyframe ? SIZE_MAX : encodeDelta(_previous.data(), frame, _frameBytes, _scratch.data(), _frameBytes);
+    const size_t rleBytes = encodeRle(frame, _frameBytes, payload, std::min(deltaBytes, _frameBytes));
+    if (0u != rleBytes) {
+        type = Rle;
+        payloadBytes = rleBytes;
+    } else if (deltaBytes < payloadBytes) {
+        type = Delta;
+        payloadBytes = deltaBytes;
+        memcpy(payload, _scratch.data(), deltaBytes);
+    } else {
+        memcpy(payload, frame, _frameBytes);
+    }
+
+    if (isKeyframe) {
+        _index.push_back({timestampUs, _size, _frameCount});
+    }
+    // The header comes last, so the record is only found by a recovering reader once its payload is complete.
+    put32(record, static_cast<uint32_t>(timestampUs - _lastTimestampUs));
+    record[4] = type;
+    put32(record + 5u, static_cast<uint32_t>(payloadBytes));
+
+    _size += FRAME_LOG_RECORD_BYTES + payloadBytes;
+    _lastTimestampUs = timestampUs;
+    _frameCount++;
+    memcpy(_previous.data(), frame, _frameBytes);
+    return true;
+}
+
+/**
+ * Writes the key frame index and the final header, then trims the file to its content.
+ *
+ * @return true if the log was complete and written successfully.
+ */
+bool FrameLogWriter::close() {
+    if (!isOpen()) return false;
+
+    bool res = false;
+    const size_t indexBytes = 8u + _index.size() * 24u;
+    if (reserve(indexBytes)) {
+        const size_t indexOffset = _size;
+        put64(_map + indexOffset, _index.size());
+        for (size_t i = 0; i < _index.size(); i++) {
+            uint8_t* entry = _map + indexOffset + 8u + i * 24u;
+            put64(entry, _index[i].timestampUs);
+            put64(entry + 8u, _index[i].offset);
+            put64(entry + 16u, _index[i].frameNumber);
+        }
+        _size += indexBytes;
+        writeHeader(indexOffset);
+        res = true;
+    }
+
+    if (_map) munmap(_map, _mapSize);
+    _map = nullptr;
+    _mapSize = 0u;
+    if (0 != ftruncate(_fd, static_cast<off_t>(_size))) res = false;
+    ::close(_fd);
+    _fd = -1;
+    return res;
+}
+
+FrameLogReader::~FrameLogReader() {
+    close();
+}
+
+/**
+ * Maps a frame log and validates its header and index. A log that was not closed, after a crash or while it is
+ * being recorded, has no index, its complete records are scanned instead.
+ *
+ * @param path The path of the log file.
+ * @return true if the log can be played.
+ */
+bool FrameLogReader::open(const std::string& path) {
+    close();
+
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        LOGE("Failed to open frame log %s", path.c_str());
+        return false;
+    }
+    struct stat info{};
+    if (0 != fstat(fd, &info) || static_cast<size_t>(info.st_size) < FRAME_LOG_HEADER_BYTES) {
+        ::close(fd);
+        LOGE("Frame log %s is too short", path.c_str());
+        return false;
+    }
+    void* map = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (MAP_FAILED == map) {
+        LOGE("Failed to map frame log %s", path.c_str());
+        return false;
+    }
+    _map = static_cast<const uint8_t*>(map);
+    _size = static_cast<size_t>(info.st_size);
+
+    const uint64_t indexOffset = get64(_map + 32u);
+    if (0 != memcmp(_map, FRAME_LOG_MAGIC, 4u) || FRAME_LOG_VERSION != get32(_map + 4u) || 0u == get32(_map + 8u) ||
+        0u == get32(_map + 12u) || (0u != indexOffset && (indexOffset < FRAME_LOG_HEADER_BYTES || indexOffset + 8u > _size))) {
+        LOGE("Frame log %s is invalid", path.c_str());
+        close();
+        return false;
+    }
+    _frameBytes = get32(_map + 8u);
+    if (0u == indexOffset) {
+        scanRecords(get32(_map + 12u));
+        LOGW("Frame log %s was not closed, recovered %llu frames", path.c_str(),
+             static_cast<unsigned long long>(_frameCount));
+        rewind();
+        return true;
+    }
+    _frameCount = get64(_map + 16u);
+    _durationUs = get64(_map + 24u);
+    _recordsEnd = static_cast<size_t>(indexOffset);
+
+    const uint64_t indexCount = get64(_map + indexOffset);
+    if (indexCount > (_size - indexOffset - 8u) / 24u) {
+        LOGE("Frame log %s has a truncated index", path.c_str());
+        close();
+        return false;
+    }
+    for (uint64_t i = 0; i < indexCount; i++) {
+        const uint8_t* entry = _map + indexOffset + 8u + i * 24u;
+        _index.push_back({get64(entry), get64(entry + 8u), get64(entry + 16u)});
+    }
+
+    rewind();
+    return true;
+}
+
+/**
+ * Rebuilds the frame count, the duration and the key frame index of a log that was not closed, from its records.
+ * The records end at the first one that is incomplete or doesn't fit the log, the zeros the file was grown with
+ * end them too.
+ *
+ * @param keyframeInterval The number of frames between two key frames, from the header.
+ */
+void FrameLogReader::scanRecords(uint32_t keyframeInterval) {
+    size_t pos = FRAME_LOG_HEADER_BYTES;
+    uint64_t timestampUs = 0u;
+    uint64_t frameCount = 0u;
+    while (pos + FRAME_LOG_RECORD_BYTES <= _size) {
+        const uint8_t* record = _map + pos;
+        const uint8_t type = record[4];
+        const size_t payloadBytes = get32(record + 5u);
+        const bool isKeyframe = 0u == frameCount % keyframeInterval;
+        const bool isValid = (Raw == type && payloadBytes == _frameBytes) ||
+                             (Rle == type && 0u != payloadBytes && 0u == payloadBytes % (2u + kPixelBytes)) ||
+                             (Delta == type && !isKeyframe);
+        if (!isValid || payloadBytes > _size - pos - FRAME_LOG_RECORD_BYTES) break;
+
+        timestampUs += get32(record);
+        if (isKeyframe) {
+            _index.push_back({timestampUs, pos, frameCount});
+        }
+        frameCount++;
+        pos += FRAME_LOG_RECORD_BYTES + payloadBytes;
+    }
+    _recordsEnd = pos;
+    _frameCount = frameCount;
+    _durationUs = timestampUs;
+}
+
+void FrameLogReader::close() {
+    if (_map) munmap(const_cast<uint8_t*>(_map), _size);
+    _map = nullptr;
+    _size = 0u;
+    _index.clear();
+    _frameCount = 0u;
+    _durationUs = 0u;
+}
+
+/**
+ * Goes back to the first frame.
+ */
+void FrameLogReader::rewind() {
+    _pos = FRAME_LOG_HEADER_BYTES;
+    _timestampUs = 0u;
+    _hasFrame = false;
+}
+
+/**
+ * Positions the reader on the last key frame at or before the given time.
+ *
+ * @param timestampUs The time to seek to, since the start of the recording.
+ * @return true if such a key frame exists.
+ */
+bool FrameLogReader::seek(uint64_t timestampUs) {
+    auto it = std::upper_bound(_index.begin(), _index.end(), timestampUs,
+                               [](uint64_t t, const FrameLogIndexEntry& entry) { return t < entry.timestampUs; });
+    if (it == _index.begin()) return false;
+    --it;
+    if (it->offset + FRAME_LOG_RECORD_BYTES > _recordsEnd) return false;
+
+    // The reader adds the record delta to the running timestamp, start from just before the key frame.
+    _pos = static_cast<size_t>(it->offset);
+    _timestampUs = it->timestampUs - get32(_map + _pos);
+    _hasFrame = false;
+    return true;
+}
+
+/**
+ * Decodes the next frame. Delta frames are applied on the buffer content, so the same buffer must be passed
+ * on every call, and it must be getFrameBytes() long.
+ *
+ * @param frame The frame buffer to update.
+ * @param timestampUs Receives the time of the frame since the start of the recording.
+ * @return true if a frame was decoded, false at the end of the log or on a corrupt record.
+ */
+bool FrameLogReader::next(uint8_t* frame, uint64_t& timestampUs) {
+    if (!_map || _pos + FRAME_LOG_RECORD_BYTES > _recordsEnd) return false;
+
+    const uint8_t* record = _map + _pos;
+    const uint8_t type = record[4];
+    const size_t payloadBytes = get32(record + 5u);
+    if (_pos + FRAME_LOG_RECORD_BYTES + payloadBytes > _recordsEnd) return false;
+    const uint8_t* payload = record + FRAME_LOG_RECORD_BYTES;
+
+    if (Raw == type) {
+        if (payloadBytes != _frameBytes) return false;
+        memcpy(frame, payload, _frameBytes);
+    } else if (Rle == type) {
+        size_t o = 0u;
+        for (size_t i = 0; i + 2u + kPixelBytes <= payloadBytes; i += 2u + kPixelBytes) {
+            const size_t count = get16(payload + i);
+            if (o + count * kPixelBytes > _frameBytes) return false;
+            for (size_t c = 0; c < count; c++, o += kPixelBytes) {
+                memcpy(frame + o, payload + i + 2u, kPixelBytes);
+            }
+        }
+        if (o != _frameBytes) return false;
+    } else if (Delta == type && _hasFrame) {
+        size_t o = 0u;
+        for (size_t i = 0; i + 4u <= payloadBytes;) {
+            const size_t skip = get16(payload + i);
+            const size_t length = get16(payload + i + 2u);
+            if (o + skip + length > _frameBytes || i + 4u + length > payloadBytes) return false;
+            o += skip;
+            memcpy(frame + o, payload + i + 4u, length);
+            o += length;
+            i += 4u + length;
+        }
+    } else {
+        return false;
+    }
+
+    _timestampUs += get32(record);
+    timestampUs = _timestampUs;
+    _hasFrame = true;
+    _pos += FRAME_LOG_RECORD_BYTES + payloadBytes;
+    return true;
+}
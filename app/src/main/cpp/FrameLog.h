@@ -0,0 +1,106 @@
+#ifndef LEDFX_FRAMELOG_H
+#define LEDFX_FRAMELOG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * LED frame log file layout, all fields little endian:
+ *  - Header, FRAME_LOG_HEADER_BYTES long: magic "LFXL", version (u32), frame bytes (u32), key frame interval (u32),
+ *    frame count (u64), duration in us (u64), index offset (u64, 0 while recording).
+ *  - Records: timestamp delta in us since the previous frame (u32), type (u8), payload bytes (u32), payload.
+ *    Raw payloads hold the whole frame, Rle payloads runs of identical RGB pixels (u16 count + 3 bytes),
+ *    Delta payloads changed spans against the previous frame (u16 skipped bytes, u16 length, bytes).
+ *  - Index of the key frames: count (u64), then timestamp in us, file offset and frame number (3 x u64) per key frame.
+ * Key frames (Raw or Rle) are written every key frame interval, so playback can seek without decoding the whole log.
+ * A record's header is written after its payload and the file is grown with zeros, so a log that was not closed,
+ * with a 0 index offset, still holds complete records up to the first zero header, see FrameLogReader::open().
+ */
+#define FRAME_LOG_MAGIC "LFXL"
+#define FRAME_LOG_VERSION 1u
+#define FRAME_LOG_HEADER_BYTES 40u
+#define FRAME_LOG_RECORD_BYTES 9u
+
+struct FrameLogIndexEntry {
+    uint64_t timestampUs;
+    uint64_t offset;
+    uint64_t frameNumber;
+};
+
+/**
+ * @brief Writes LED frames into a frame log through a memory mapping of the file.
+ * Appending only encodes into the mapping, the file is grown in large steps. It still faults in pages of the
+ * file and grows the key frame index, so realtime threads record through a FrameLogRecorder.
+ */
+class FrameLogWriter {
+public:
+    FrameLogWriter() = default;
+    FrameLogWriter(const FrameLogWriter&) = delete;
+    FrameLogWriter& operator=(const FrameLogWriter&) = delete;
+    ~FrameLogWriter();
+
+    bool open(const std::string& path, size_t frameBytes, uint32_t keyframeInterval = 256u);
+    bool append(const uint8_t* frame, size_t numBytes, uint64_t timestampUs);
+    bool close();
+
+    bool isOpen() const { return _fd >= 0; }
+    uint64_t getFrameCount() const { return _frameCount; }
+    size_t getSize() const { return _size; }
+
+private:
+    int _fd = -1;
+    uint8_t* _map = nullptr;
+    size_t _mapSize = 0u;
+    size_t _size = 0u;        // Bytes written so far.
+    size_t _frameBytes = 0u;
+    uint32_t _keyframeInterval = 0u;
+    uint64_t _frameCount = 0u;
+    uint64_t _lastTimestampUs = 0u;
+    std::vector<uint8_t> _previous;  // Last appended frame, reference of the delta encoding.
+    std::vector<uint8_t> _scratch;   // Encoding buffer, sized for the worst case.
+    std::vector<FrameLogIndexEntry> _index;
+
+    bool reserve(size_t numBytes);
+    void writeHeader(uint64_t indexOffset);
+};
+
+/**
+ * @brief Reads a frame log through a read-only memory mapping, decoding one frame at a time.
+ */
+class FrameLogReader {
+public:
+    FrameLogReader() = default;
+    FrameLogReader(const FrameLogReader&) = delete;
+    FrameLogReader& operator=(const FrameLogReader&) = delete;
+    ~FrameLogReader();
+
+    bool open(const std::string& path);
+    void close();
+
+    bool next(uint8_t* frame, uint64_t& timestampUs);
+    bool seek(uint64_t timestampUs);
+    void rewind();
+
+    size_t getFrameBytes() const { return _frameBytes; }
+    uint64_t getFrameCount() const { return _frameCount; }
+    uint64_t getDurationUs() const { return _durationUs; }
+
+private:
+    const uint8_t* _map = nullptr;
+    size_t _size = 0u;
+    size_t _frameBytes = 0u;
+    uint64_t _frameCount = 0u;
+    uint64_t _durationUs = 0u;
+    size_t _recordsEnd = 0u;   // End of the records, start of the index.
+    size_t _pos = 0u;          // Offset of the next record.
+    uint64_t _timestampUs = 0u;
+    bool _hasFrame = false;    // Delta records need a decoded frame to apply to.
+    std::vector<FrameLogIndexEntry> _index;
+
+    void scanRecords(uint32_t keyframeInterval);
+};
+
+
+#endif //LEDFX_FRAMELOG_H
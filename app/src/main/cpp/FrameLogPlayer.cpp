@@ -0,0 +1,78 @@
+#include <chrono>
+#include "logging_macros.h"
+#include "FrameLogPlayer.h"
+
+FrameLogPlayer::~FrameLogPlayer() {
+    stop();
+}
+
+/**
+ * Opens a frame log and starts sending its frames, the device is activated for the duration of the playback.
+ * Any playback in progress is stopped first.
+ *
+ * @param path The path of the frame log.
+ * @param device The device to send the frames to, configured for the LED count of the log.
+ * @param isLooping true to restart from the first frame at the end of the log.
+ * @return true if the playback started.
+ */
+bool FrameLogPlayer::start(const std::string& path, std::shared_ptr<WLedDevice> device, bool isLooping) {
+    stop();
+    if (!_reader.open(path)) return false;
+
+    _device = std::move(device);
+    _ledData.assign(_reader.getFrameBytes(), 0u);
+    _isLooping = isLooping;
+    if(!_device->activate())
+        LOGE("Failed to activate device");
+
+    _shouldStop.store(false, std::memory_order_relaxed);
+    _isPlaying.store(true, std::memory_order_release);
+    _thread = std::thread(&FrameLogPlayer::run, this);
+    LOGI("Playing frame log %s: %llu frames, %.2f s", path.c_str(),
+         static_cast<unsigned long long>(_reader.getFrameCount()), _reader.getDurationUs() / 1e6);
+    return true;
+}
+
+/**
+ * Stops the playback and waits for the playback thread, then releases the log and the device.
+ */
+void FrameLogPlayer::stop() {
+    if (!_thread.joinable()) return;
+
+    _shouldStop.store(true, std::memory_order_relaxed);
+    _thread.join();
+    _device->deactivate();
+    _device.reset();
+    _reader.close();
+}
+
+/**
+ * Playback loop, sleeps until the time of each frame relative to the start of the playback and sends it.
+ * The deadlines don't move, so the frames that got late in a stall are sent back to back until the playback
+ * catches up: the show keeps its timing and no frame is skipped.
+ * Stops at the end of the log, or when looping over a log of which no frame could be decoded.
+ */
+void FrameLogPlayer::run() {
+    auto start = std::chrono::steady_clock::now();
+    uint64_t timestampUs = 0u;
+    bool hasDecoded = false;  // A frame was decoded since the last rewind.
+
+    while (!_shouldStop.load(std::memory_order_relaxed)) {
+        if (!_reader.next(_ledData.data(), timestampUs)) {
+            if (!_isLooping || !hasDecoded) {
+                if (_isLooping) LOGE("No frame of the frame log can be decoded, stopping the playback");
+                break;
+            }
+            _reader.rewind();
+            start = std::chrono::steady_clock::now();
+            hasDecoded = false;
+            continue;
+        }
+        hasDecoded = true;
+        std::this_thread::sleep_until(start + std::chrono::microseconds(timestampUs));
+        if (const WLedDevice::Config* config = _device->acquireConfig()) {
+            _device->flush(*config, _ledData.data(), _ledData.size());
+        }
+    }
+    _isPlaying.store(false, std::memory_order_release);
+}
@@ -0,0 +1,41 @@
+#ifndef LEDFX_FRAMELOGPLAYER_H
+#define LEDFX_FRAMELOGPLAYER_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "FrameLog.h"
+#include "WLedDevice.h"
+
+/**
+ * @brief Plays a frame log to a WLED device from its own thread, with the recorded timing and without any DSP.
+ * start() and stop() must be called from the same thread.
+ */
+class FrameLogPlayer {
+public:
+    FrameLogPlayer() = default;
+    FrameLogPlayer(const FrameLogPlayer&) = delete;
+    FrameLogPlayer& operator=(const FrameLogPlayer&) = delete;
+    ~FrameLogPlayer();
+
+    bool start(const std::string& path, std::shared_ptr<WLedDevice> device, bool isLooping);
+    void stop();
+
+    bool isPlaying() const { return _isPlaying.load(std::memory_order_acquire); }
+
+private:
+    FrameLogReader _reader;
+    std::shared_ptr<WLedDevice> _device;
+    std::vector<uint8_t> _ledData;  // Frame decoded from the log.
+    bool _isLooping = false;
+    std::atomic<bool> _isPlaying{false};
+    std::atomic<bool> _shouldStop{false};
+    std::thread _thread;
+
+    void run();
+};
+
+
+#endif //LEDFX_FRAMELOGPLAYER_H
@@ -0,0 +1,111 @@
+#include <cerrno>
+#include <cstring>
+#include "logging_macros.h"
+#include "FrameLogRecorder.h"
+
+FrameLogRecorder::FrameLogRecorder() {
+    sem_init(&_wakeup, 0, 0u);
+}
+
+FrameLogRecorder::~FrameLogRecorder() {
+    stop();
+    sem_destroy(&_wakeup);
+}
+
+/**
+ * Creates the log file and starts the recorder thread. Any recording in progress is completed first.
+ *
+ * @param path The path of the log file, replaced if it exists.
+ * @param frameBytes The size of every frame, in bytes.
+ * @return true if the recording started.
+ */
+bool FrameLogRecorder::start(const std::string& path, size_t frameBytes) {
+    stop();
+    if (!_writer.open(path, frameBytes)) return false;
+
+    _frameBytes = frameBytes;
+    _frames.assign(FRAME_LOG_QUEUE_FRAMES * frameBytes, 0u);
+    _timestamps.assign(FRAME_LOG_QUEUE_FRAMES, 0u);
+    _head.store(0u, std::memory_order_relaxed);
+    _tail.store(0u, std::memory_order_relaxed);
+    _droppedCount.store(0u, std::memory_order_relaxed);
+    _shouldStop.store(false, std::memory_order_relaxed);
+    _isRecording.store(true, std::memory_order_relaxed);
+    _thread = std::thread(&FrameLogRecorder::run, this);
+    return true;
+}
+
+/**
+ * Queues a frame for the recorder thread, without waiting, allocating or any system call besides waking it up.
+ * A frame of another size than the one given to start() ends the recording.
+ *
+ * @param frame The frame bytes, copied.
+ * @param numBytes The size of the frame.
+ * @param timestampUs The time of the frame since the start of the recording, see FrameLogWriter::append().
+ * @return false if the frame ended the recording or it had already ended, true if it was queued or dropped.
+ */
+bool FrameLogRecorder::append(const uint8_t* frame, size_t numBytes, uint64_t timestampUs) {
+    if (!isRecording()) return false;
+    if (numBytes != _frameBytes) {
+        _isRecording.store(false, std::memory_order_relaxed);
+        return false;
+    }
+
+    const uint64_t head = _head.load(std::memory_order_relaxed);
+    if (head - _tail.load(std::memory_order_acquire) >= FRAME_LOG_QUEUE_FRAMES) {
+        _droppedCount.fetch_add(1u, std::memory_order_relaxed);
+        return true;
+    }
+    const size_t slot = head % FRAME_LOG_QUEUE_FRAMES;
+    memcpy(_frames.data() + slot * _frameBytes, frame, numBytes);
+    _timestamps[slot] = timestampUs;
+    _head.store(head + 1u, std::memory_order_release);
+    sem_post(&_wakeup);
+    return true;
+}
+
+/**
+ * Stops the recorder thread once it wrote the queued frames, then completes the log, see FrameLogWriter::close().
+ *
+ * @return true if a recording was completed without errors.
+ */
+bool FrameLogRecorder::stop() {
+    if (!_thread.joinable()) return false;
+
+    _shouldStop.store(true, std::memory_order_release);
+    sem_post(&_wakeup);
+    _thread.join();
+    const bool isComplete = _isRecording.exchange(false, std::memory_order_relaxed);
+    const bool isClosed = _writer.close();
+    if (0u != _droppedCount.load(std::memory_order_relaxed)) {
+        LOGW("Frame log dropped %llu frames, the storage was too slow",
+             static_cast<unsigned long long>(_droppedCount.load(std::memory_order_relaxed)));
+    }
+    return isComplete && isClosed;
+}
+
+/**
+ * Recorder thread loop, writes the queued frames every time it is woken up. A write error ends the recording,
+ * the frames written until then stay in the log.
+ */
+void FrameLogRecorder::run() {
+    while (true) {
+        if (0 != sem_wait(&_wakeup)) {
+            if (EINTR != errno) LOGE("Frame log recorder failed to wait for frames");
+            continue;
+        }
+
+        const uint64_t head = _head.load(std::memory_order_acquire);
+        uint64_t tail = _tail.load(std::memory_order_relaxed);
+        for (; tail < head; tail++) {
+            const size_t slot = tail % FRAME_LOG_QUEUE_FRAMES;
+            if (isRecording() && !_writer.append(_frames.data() + slot * _frameBytes, _frameBytes, _timestamps[slot])) {
+                LOGE("Frame log recording stopped, a frame could not be written");
+                _isRecording.store(false, std::memory_order_relaxed);
+            }
+        }
+        _tail.store(tail, std::memory_order_release);
+
+        if (_shouldStop.load(std::memory_order_acquire) && head == _head.load(std::memory_order_acquire)) break;
+    }
+}
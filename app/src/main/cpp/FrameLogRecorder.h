@@ -0,0 +1,53 @@
+#ifndef LEDFX_FRAMELOGRECORDER_H
+#define LEDFX_FRAMELOGRECORDER_H
+
+#include <semaphore.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "FrameLog.h"
+
+#define FRAME_LOG_QUEUE_FRAMES 64u  // Frames waiting to be written, a quarter of a second of output.
+
+/**
+ * @brief Records LED frames to a frame log from a realtime thread. append() only copies the frame into a queue
+ * allocated by start(), the recorder's own thread encodes it and does all the file work, growing and mapping
+ * the file, the key frame index and closing. A frame that finds the queue full is dropped and counted.
+ * start() and stop() must be called from the same thread, append() from a single other one.
+ */
+class FrameLogRecorder {
+public:
+    FrameLogRecorder();
+    FrameLogRecorder(const FrameLogRecorder&) = delete;
+    FrameLogRecorder& operator=(const FrameLogRecorder&) = delete;
+    ~FrameLogRecorder();
+
+    bool start(const std::string& path, size_t frameBytes);
+    bool append(const uint8_t* frame, size_t numBytes, uint64_t timestampUs);
+    bool stop();
+
+    /**
+     * @return true from start() until stop(), or until a frame of another size or a write error ended the recording.
+     */
+    bool isRecording() const { return _isRecording.load(std::memory_order_relaxed); }
+    uint64_t getDroppedCount() const { return _droppedCount.load(std::memory_order_relaxed); }
+
+private:
+    FrameLogWriter _writer;             // Recorder thread only, between start() and stop().
+    size_t _frameBytes = 0u;
+    std::vector<uint8_t> _frames;       // FRAME_LOG_QUEUE_FRAMES slots of _frameBytes.
+    std::vector<uint64_t> _timestamps;
+    std::atomic<uint64_t> _head{0u};    // Frames queued so far, written by append().
+    std::atomic<uint64_t> _tail{0u};    // Frames written so far, written by the recorder thread.
+    sem_t _wakeup;                      // Posted by every append(), lock free and safe on the audio thread.
+    std::atomic<bool> _isRecording{false};
+    std::atomic<bool> _shouldStop{false};
+    std::atomic<uint64_t> _droppedCount{0u};
+    std::thread _thread;
+
+    void run();
+};
+
+
+#endif //LEDFX_FRAMELOGRECORDER_H
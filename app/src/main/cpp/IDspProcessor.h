@@ -7,6 +7,8 @@
 
 #include <memory>
 #include "ExpFilter.h"
+#include "AudioFeatures.h"
+#include "LogSpectrum.h"
 
 /**
  * @brief class for DSP (Digital Signal Processing) processing.
@@ -17,11 +19,60 @@ public:
     /**
      * Pure virtual function that performs Mel-Bank processing on the provided audio data.
      *
-     * @param audioData A pointer to the audio data buffer that will be processed.
-     * @param dataS The size of the audio data buffer in bytes.
+     * @param audioData A pointer to the interleaved audio data buffer that will be processed.
+     * @param numFrames The number of frames in the audio data buffer.
      * @param melBank A shared pointer to an ExpFilter object, which is used to process the Mel-Bank.
      */
-    virtual void doMelBank(void* audioData, const size_t dataS, std::shared_ptr<ExpFilter> melBank) = 0;
+    virtual void doMelBank(void* audioData, const size_t numFrames, std::shared_ptr<ExpFilter> melBank) = 0;
+
+    /**
+     * Pure virtual function that performs Mel-Bank processing on each channel of the provided stereo audio data.
+     *
+     * @param audioData A pointer to the interleaved audio data buffer that will be processed.
+     * @param numFrames The number of frames in the audio data buffer.
+     * @param melBank A shared pointer to an ExpFilter object, updated with the Mel-Bank of both channels.
+     * @param leftMelBank A shared pointer to an ExpFilter object, updated with the Mel-Bank of the left channel.
+     * @param rightMelBank A shared pointer to an ExpFilter object, updated with the Mel-Bank of the right channel.
+     */
+    virtual void doStereoMelBank(void* audioData, const size_t numFrames, std::shared_ptr<ExpFilter> melBank,
+                                 std::shared_ptr<ExpFilter> leftMelBank, std::shared_ptr<ExpFilter> rightMelBank) = 0;
+
+    /**
+     * Returns the features (onset, beat, tempo) extracted from the same spectrum as the last Mel-Bank.
+     *
+     * @return A reference to the features of the latest processed hop.
+     */
+    virtual const AudioFeatures& getFeatures() const = 0;
+
+    /**
+     * Computes the spectrum only once every few hops, to lower the CPU load.
+     *
+     * @param decimation 1 to analyse every hop, 2 to analyse every other hop and so on.
+     */
+    virtual void setHopDecimation(const uint32_t decimation) = 0;
+
+    /**
+     * Returns the number of hops whose spectrum was computed, hops skipped by the decimation excluded.
+     *
+     * @return The count since the processor was created.
+     */
+    virtual uint64_t getAnalyzedHopCount() const = 0;
+
+    /**
+     * Computes half the Mel bands and repeats each of them twice, to lower the CPU load.
+     *
+     * @param isReduced true to compute half the bands.
+     */
+    virtual void setReducedBands(const bool isReduced) = 0;
+
+    /**
+     * Also computes a log-frequency spectrum from the spectrum of every analysed hop, the mono one,
+     * or the mid one of the stereo analysis.
+     *
+     * @param logSpectrum The band kernels, built for the FFT size of the processor, nullptr to stop computing it.
+     * @param levels A shared pointer to an ExpFilter object, updated with the band levels.
+     */
+    virtual void setLogSpectrum(std::shared_ptr<LogSpectrum> logSpectrum, std::shared_ptr<ExpFilter> levels) = 0;
 
     /**
      * Virtual destructor for the interface, ensuring proper cleanup of derived classes.
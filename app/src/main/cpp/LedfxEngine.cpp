@@ -17,53 +17,154 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <chrono>
 
 
 /**
  * @brief Constructor for the LedfxEngine class.
- * This constructor initializes all necessary components for the LED effects engine,
- * including filters, digital signal processing (DSP) processor, and LED device control.
- * It sets up the mel filter bank, input volume filter, DSP processor, and prepares the data structure for controlling LEDs.
+ * This constructor initializes the LED device control, the audio pipeline (filters, DSP processor
+ * and the LED frame for 60 LEDs) is initialized as a member.
+ * @param sender The thread sending the LED frames, shared by all engines.
  */
-LedfxEngine::LedfxEngine() {
-
-    // Initialize the mel filter bank with an initial value of 0.0, using a decay factor of 0.70 and a rise factor of 0.90.
-    // This is used for processing frequency data with a smooth transition.
-    // The filter is initially not enabled (false), and the filter size is defined by FILTER_SIZE.
-    _melBankOutput = std::make_shared<ExpFilter>(0.0f, 0.70f, 0.90f, false, FILTER_SIZE);
-    LOGD("Mel filter bank initialized with decay (0.70) and rise (0.90) factors.");
-
-    // Initialize the input volume filter with an initial value of -90.0 dB, and both decay and rise factors set to 0.99.
-    // This filter will smooth the volume input over time to avoid abrupt changes.
-    // It is initially enabled (true), and the size is set to 1 (representing a single value).
-    _inVolFilter = std::make_shared<ExpFilter>(-90.0f, 0.99f, 0.99f, true, 1u);
-    LOGD("Input volume filter initialized with high smoothing factors (0.99) for decay and rise.");
-
-    // Initialize the DSP processor with the given FFT size, hop size, filter size, sample rate, and frequency range.
-    // The DSP processor will process incoming audio data and extract features like frequency bins.
-    _dspProcessor = std::make_unique<AubioDspProcessor>(FFT_SIZE, HOP_SIZE, FILTER_SIZE, SAMPLE_RATE, MIN_FREQ_HZ, MAX_FREQ_HZ);
-    LOGD("DSP Processor (Aubio) initialized with FFT_SIZE = %i, HOP_SIZE = %i, and sample rate = %i Hz.", FFT_SIZE, HOP_SIZE, SAMPLE_RATE);
+LedfxEngine::LedfxEngine(std::shared_ptr<OutputSender> sender) : _sender(std::move(sender)) {
 
     // Initialize the LED device controller, which will handle communication with the physical LED hardware.
     _device = std::make_shared<WLedDevice>();
     LOGD("LED Device controller initialized.");
 
-    // Prepare a shared vector to hold the LED data. This data structure will contain the LED control data
-    // (color, brightness, etc.) for all 60 LEDs, with each LED's data occupying `BYTES_PER_LED` bytes.
-    // An additional 2 bytes are reserved for protocol and timeout information.
-    _ledData = std::make_shared<std::vector<uint8_t>>((60 * BYTES_PER_LED) + 2, 0u);
-    LOGD("LED data structure initialized for 60 LEDs with %d bytes per LED.", BYTES_PER_LED);
-
     // At this point, all core components are initialized and ready for use.
 }
 
+/**
+ * @brief Destructor, turns the effect off so no stream calls back into a deleted engine.
+ */
+LedfxEngine::~LedfxEngine() {
+    setEffectOn(false);
+}
+
 
 /**
- * Sets the ID of the device used for recording audio.
+ * Sets the ID of the device used for recording audio. While the effect is on, only the input stream
+ * is reopened on the new device, see switchInput().
  * @param deviceId The ID of the recording device to set.
  */
 void LedfxEngine::setRecordingDeviceId(int32_t deviceId) {
+    std::lock_guard<std::mutex> lock(_streamLock);
+    if (deviceId == _recordingDeviceId) return;
     _recordingDeviceId = deviceId;
+    if (_isEffectOn && switchInput() != oboe::Result::OK) {
+        LOGE("Failed to switch to recording device %d", deviceId);
+    }
+}
+
+/**
+ * Selects between mono analysis and separate analysis of the left and right channels.
+ * Takes effect on the next audio callback, it can be changed while the effect is on.
+ * @param isStereo True to analyse both channels separately, false to analyse their mix.
+ */
+void LedfxEngine::setStereoAnalysis(bool isStereo) {
+    _pipeline.setStereoAnalysis(isStereo);
+}
+
+/**
+ * Returns the state of the CPU budget governor.
+ * @return The current quality level, the number of level transitions so far, and the smoothed load in percent.
+ */
+std::array<int32_t, 3> LedfxEngine::getQualityStats() const {
+    return {static_cast<int32_t>(_loadGovernor.getLevel()),
+            static_cast<int32_t>(_loadGovernor.getTransitionCount()),
+            static_cast<int32_t>(_loadGovernor.getLoad() * 100.0f)};
+}
+
+/**
+ * Selects between the float analysis and the fixed point one, which captures int16 PCM and skips
+ * the float conversion and float FFT entirely. This method will fail if the effect is currently enabled.
+ * @param isFixedPoint True for the fixed point analysis, false for the float one.
+ * @return True if the analysis was successfully set, otherwise false.
+ */
+bool LedfxEngine::setFixedPointAnalysis(bool isFixedPoint) {
+    std::lock_guard<std::mutex> lock(_streamLock);
+    if (_isEffectOn) return false;
+    const oboe::AudioFormat format = isFixedPoint ? oboe::AudioFormat::I16 : oboe::AudioFormat::Float;
+    _format = format;
+    _pipeline.setFixedPointAnalysis(isFixedPoint);
+    return true;
+}
+
+/**
+ * Renders a log-frequency spectrum of many bands across the strip instead of the Mel bands, for long strips.
+ * This method will fail if the effect is currently enabled.
+ * @param bandCount The number of bands, clamped to LOG_SPECTRUM_MIN_BANDS to LOG_SPECTRUM_MAX_BANDS and to the
+ * bands the FFT resolves, see LogSpectrum::getResolvableBandCount(), 0 to render the Mel bands.
+ * @return True if the spectrum was successfully set, otherwise false.
+ */
+bool LedfxEngine::setLogSpectrumBands(int32_t bandCount) {
+    std::lock_guard<std::mutex> lock(_streamLock);
+    if (_isEffectOn) return false;
+    _pipeline.setLogSpectrumBands(static_cast<size_t>(std::max(bandCount, 0)));
+    return true;
+}
+
+/**
+ * Selects between the single FFT float analysis and the multi-resolution one, which resolves the bass
+ * down to MULTI_RES_MIN_FREQ_HZ and detects onsets earlier. This method will fail if the effect is currently enabled.
+ * @param isMultiResolution True for the multi-resolution analysis, false for the single FFT one.
+ * @return True if the analysis was successfully set, otherwise false.
+ */
+bool LedfxEngine::setMultiResolutionAnalysis(bool isMultiResolution) {
+    std::lock_guard<std::mutex> lock(_streamLock);
+    if (_isEffectOn) return false;
+    _pipeline.setMultiResolutionAnalysis(isMultiResolution);
+    return true;
+}
+
+/**
+ * Sets the file the sent LED frames are recorded to, see FrameLog.h. Every time the effect is turned on
+ * the file is recreated, and it is completed when the effect is turned off. This method will fail if
+ * the effect is currently enabled.
+ * @param path The path of the frame log, empty to disable recording.
+ * @return True if the path was successfully set, otherwise false.
+ */
+bool LedfxEngine::setFrameLogPath(std::string path) {
+    std::lock_guard<std::mutex> lock(_streamLock);
+    if (_isEffectOn) return false;
+    _frameLogPath = std::move(path);
+    return true;
+}
+
+/**
+ * Plays a frame log to the device with its recorded timing, without capturing or analysing any audio.
+ * This method will fail if the effect is currently enabled, turning the effect on stops the replay.
+ * @param path The path of the frame log.
+ * @param isLooping True to restart at the end of the log.
+ * @return True if the replay started, otherwise false.
+ */
+bool LedfxEngine::startReplay(std::string path, bool isLooping) {
+    std::lock_guard<std::mutex> lock(_streamLock);
+    if (_isEffectOn) return false;
+    return _frameLogPlayer.start(path, _device, isLooping);
+}
+
+/**
+ * Stops the frame log replay, if any. Serialized with startReplay() and setEffectOn(), which stops it too.
+ */
+void LedfxEngine::stopReplay() {
+    std::lock_guard<std::mutex> lock(_streamLock);
+    _frameLogPlayer.stop();
+}
+
+/**
+ * Sets the wire protocol of the LED device. DNRGB and DDP split long strips across packets,
+ * DRGB is limited to a single packet. This method will fail if the effect is currently enabled
+ * or a frame log is being replayed.
+ * @param protocol The protocol to send the LED frames with.
+ * @return True if the protocol was successfully set, otherwise false.
+ */
+bool LedfxEngine::setOutputProtocol(WLedDevice::Protocol protocol) {
+    std::lock_guard<std::mutex> lock(_streamLock);
+    if (_isEffectOn || _frameLogPlayer.isPlaying() || !_device) return false;
+    _device->setProtocol(protocol);
+    return true;
 }
 
 /**
@@ -75,15 +176,33 @@ bool LedfxEngine::isAAudioRecommended() {
 }
 
 /**
- * Sets the audio API for the application. This method will fail if
- * the effect is currently enabled.
+ * Sets the audio API for the application. While the effect is on, only the input stream is reopened
+ * with the new API, see switchInput(), and the previous API is restored if that fails.
  * @param api The audio API to set.
  * @return True if the audio API was successfully set, otherwise false.
  */
 bool LedfxEngine::setAudioApi(oboe::AudioApi api) {
-    if (_isEffectOn) return false;
+    std::lock_guard<std::mutex> lock(_streamLock);
+    if (api == _audioApi) return true;
+    const oboe::AudioApi previousApi = _audioApi;
     _audioApi = api;
-    return true;
+    if (!_isEffectOn || switchInput() == oboe::Result::OK) return true;
+
+    LOGE("Failed to switch the audio API, restoring the previous one");
+    _audioApi = previousApi;
+    if (switchInput() != oboe::Result::OK) {
+        LOGE("Failed to restore the input stream");
+    }
+    return false;
+}
+
+/**
+ * Returns the timing of the input stream switches.
+ * @return The number of switches, and the time in us from the start of the last switch to the first callback
+ * of the new stream, which is how long the LED output paused.
+ */
+std::array<int64_t, 2> LedfxEngine::getInputSwitchStats() const {
+    return {_inputSwitchCount.load(std::memory_order_relaxed), _lastInputSwitchUs.load(std::memory_order_relaxed)};
 }
 
 /**
@@ -93,15 +212,41 @@ bool LedfxEngine::setAudioApi(oboe::AudioApi api) {
  * @return True if the effect was successfully set, otherwise false.
  */
 bool LedfxEngine::setEffectOn(bool isOn){
+    std::lock_guard<std::mutex> lock(_streamLock);
     bool success = true;
     if (isOn != _isEffectOn) {
         if (isOn) {
+            _pipeline.reset();
+            _loadGovernor.reset();
+            _pipeline.applyQualityLevel(LoadGovernor::Full);
+            _statsValues = EngineStats::Values();
+            _fpsWindowFrames = 0;
+            _fpsWindowSentFrames = 0u;
+            _stats.publish(_statsValues);
+            _frameLogPlayer.stop();
+            // Pick up the LED count published while stopped, the audio thread takes over the frame from here.
+            if (std::vector<uint8_t>* ledData = _ledData.acquire()) {
+                _pipeline.swapLedData(*ledData);
+            }
+            if (!_frameLogPath.empty()) {
+                _recordedAudioFrames = 0;
+                _frameLogRecorder.start(_frameLogPath, _pipeline.getLedData().size());
+            }
+            if(!_device->activate())
+                LOGE("Failed to activate device");
+            _output = _sender->addOutput(_device, _pipeline.getLedData().size());
             success = openStreams() == oboe::Result::OK;
             if (success) {
                 _isEffectOn = isOn;
+            } else {
+                closeStreams();
+                stopOutput();
+                _frameLogRecorder.stop();
             }
         } else {
             closeStreams();
+            stopOutput();
+            _frameLogRecorder.stop();
             _isEffectOn = isOn;
         }
     }
@@ -110,7 +255,9 @@ bool LedfxEngine::setEffectOn(bool isOn){
 
 /**
  * Updates the configuration for the LED device, including IP address, port number, and the number of LEDs.
- * Resizes the LED data buffer accordingly.
+ * Safe while the effect is on: the device publishes an immutable snapshot for the sender thread, a
+ * pre-allocated LED frame is published for the audio thread to adopt on its next callback, and the output
+ * reserves its frames for the new count.
  * @param iPaddr The IP address of the LED device.
  * @param portNum The port number of the LED device.
  * @param numLeds The number of LEDs to configure.
@@ -118,10 +265,21 @@ bool LedfxEngine::setEffectOn(bool isOn){
 void LedfxEngine::updateConfig(std::string iPaddr, uint16_t portNum, size_t numLeds) {
     if(_device){
         _device->updateConfig(iPaddr,portNum,numLeds);
-        _ledData->resize((numLeds*BYTES_PER_LED)+2,0);
+        _ledData.publish(std::vector<uint8_t>(numLeds * BYTES_PER_LED, 0u));
+        std::lock_guard<std::mutex> lock(_streamLock);
+        if (_output) _output->reserve(numLeds * BYTES_PER_LED);
     }
 }
 
+/**
+ * Stops sending to the LED device, waiting for a frame being sent, and closes its socket.
+ */
+void LedfxEngine::stopOutput() {
+    _sender->removeOutput(_output);
+    _output.reset();
+    _device->deactivate();
+}
+
 /**
  * Closes the audio streams in the correct order, ensuring the playback stream is stopped before the recording stream.
  */
@@ -135,7 +293,32 @@ void LedfxEngine::closeStreams() {
     * null.
     */
     closeStream(_recordingStream);
-    _device->deactivate();
+}
+
+/**
+ * Replaces the input stream with one opened with the current API, recording device and format, while the effect is on.
+ * The pipeline with its filters and silence state, the frame log and the LED device with its socket stay as they are,
+ * so the output only pauses between the last callback of the old stream and the first one of the new stream.
+ * Must be called with _streamLock held.
+ * @return The result of opening and starting the new stream.
+ */
+oboe::Result LedfxEngine::switchInput() {
+    const auto start = std::chrono::steady_clock::now();
+    closeStream(_recordingStream);
+    // Published once the old stream is stopped, so only a callback of the new stream can complete it.
+    _inputSwitchStartNs.store(std::chrono::duration_cast<std::chrono::nanoseconds>(start.time_since_epoch()).count(),
+                              std::memory_order_relaxed);
+    const oboe::Result result = openStreams();
+    if (result != oboe::Result::OK) {
+        _inputSwitchStartNs.store(0, std::memory_order_relaxed);
+        closeStream(_recordingStream);
+        return result;
+    }
+    _inputSwitchCount.fetch_add(1, std::memory_order_relaxed);
+    LOGI("Input stream replaced in %lld us, device %d",
+         static_cast<long long>(std::chrono::duration_cast<std::chrono::microseconds>(
+                 std::chrono::steady_clock::now() - start).count()), _recordingStream->getDeviceId());
+    return result;
 }
 
 /**
@@ -147,9 +330,7 @@ oboe::Result  LedfxEngine::openStreams() {
     // stream first, then use properties from the playback stream
     // (e.g. sample rate) to create the recording stream. By matching the
     // properties we should get the lowest latency path
-
-    if(!_device->activate())
-        LOGE("Failed to activate device");
+    // The LED device is activated separately, so the input can be replaced without touching the socket.
 
     // Create and setup builder for input stream.
     oboe::AudioStreamBuilder inBuilder;
@@ -247,43 +428,62 @@ void LedfxEngine::warnIfNotLowLatency(std::shared_ptr<oboe::AudioStream> &stream
  */
 oboe::DataCallbackResult LedfxEngine::onAudioReady(
         oboe::AudioStream *oboeStream, void *audioData, int32_t numFrames) {
+    const auto start = std::chrono::steady_clock::now();
+    const uint32_t level = _loadGovernor.getLevel();
+
+    // First callback after an input switch, the output was paused since the switch started.
+    const int64_t switchStartNs = _inputSwitchStartNs.load(std::memory_order_relaxed);
+    if (0 != switchStartNs) {
+        const int64_t nowNs = std::chrono::duration_cast<std::chrono::nanoseconds>(start.time_since_epoch()).count();
+        _lastInputSwitchUs.store((nowNs - switchStartNs) / 1000, std::memory_order_relaxed);
+        _inputSwitchStartNs.store(0, std::memory_order_relaxed);
+    }
 
+    // A new LED count comes with its frame already allocated, swapping it in keeps the callback allocation free.
+    if (std::vector<uint8_t>* ledData = _ledData.acquire()) {
+        _pipeline.swapLedData(*ledData);
+    }
 
-    auto samp = new_fvec(1u);
-    samp->length = numFrames*2;
-    samp->data=(float*)audioData;
-    auto vol = 1+ aubio_db_spl(samp)/100;
-    vol=std::max<float>(0,std::min<float>(1,vol));
-    _inVolFilter->update(vol);
-
-    if(_inVolFilter->value >= 0.7 ){ // default value 0.9
-
-        _dspProcessor->doMelBank(audioData, numFrames * 2, _melBankOutput);
-
-        auto calMelAvrg = [](std::vector<float>::iterator start, uint32_t size,float min)->uint8_t {
-           float val =  (std::accumulate(start,start+(size-1),0.0f))/size;
-//            return val >= min ? 1u:0u;
-            return (uint8_t)val;
-        };
-
-        uint8_t r,g,b;
-
-        r=calMelAvrg(_melBankOutput->valueVec.begin(), 4u, 1.0f);
-        g=calMelAvrg(_melBankOutput->valueVec.begin() + 4, 4u, 1.0f);
-        b=calMelAvrg(_melBankOutput->valueVec.begin() + 6, 4u, 1.0f);
-
-        for(uint8_t i= 2; i<=180;i+=3){
-
-          (*_ledData)[i]=static_cast<uint8_t>(r);
-            (*_ledData)[i+1]=static_cast<uint8_t>(g);
-            (*_ledData)[i+2]=static_cast<uint8_t>(b);
+    // Stereo analysis is the first thing to go when the CPU budget is tight.
+    if (_pipeline.process(audioData, numFrames, level >= LoadGovernor::Minimal)) {
+        std::vector<uint8_t>& ledData = _pipeline.getLedData();
+        _statsValues.renderedFrames++;
+        // Sent by the shared sender thread, the callback never waits on the socket.
+        _output->submit(ledData.data(), ledData.size());
+
+        // Only queued here, the recorder's thread writes the file. It is completed when the effect is turned off.
+        if (_frameLogRecorder.isRecording() &&
+            !_frameLogRecorder.append(ledData.data(), ledData.size(), _recordedAudioFrames * 1000000 / _sampleRate)) {
+            LOGE("Frame log recording stopped, the LED count changed");
         }
-
-    } else{
-         std::fill(_ledData->begin(),_ledData->end(),0u);
     }
-    _device->flush(_ledData->data(),_ledData->size());
-//        del_fvec(samp);
+    _recordedAudioFrames += numFrames;
+
+    _statsValues.callbacks++;
+    _statsValues.analyzedHops = _pipeline.getAnalyzedHops();
+    _statsValues.sentFrames = _output->getSentCount();
+    _statsValues.droppedFrames = _output->getDroppedCount();
+    _statsValues.sendFailures = _device->getSendFailureCount();
+    _statsValues.isSilent = _pipeline.isSilent();
+    // The output rate and the XRun count are refreshed once per second of audio.
+    _fpsWindowFrames += numFrames;
+    if (_fpsWindowFrames >= _sampleRate) {
+        _statsValues.outputFps = static_cast<float>(_statsValues.sentFrames - _fpsWindowSentFrames) * _sampleRate / _fpsWindowFrames;
+        _fpsWindowSentFrames = _statsValues.sentFrames;
+        _fpsWindowFrames = 0;
+        const oboe::ResultWithValue<int32_t> xRunCount = oboeStream->getXRunCount();
+        _statsValues.xRunCount = xRunCount ? xRunCount.value() : 0;
+    }
+    _stats.publish(_statsValues);
+
+    const auto elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    const int64_t deadlineNs = static_cast<int64_t>(numFrames) * 1000000000 / _sampleRate;
+    if (_loadGovernor.update(elapsedNs, deadlineNs)) {
+        const uint32_t newLevel = _loadGovernor.getLevel();
+        _pipeline.applyQualityLevel(newLevel);
+        LOGI("Quality level changed from %u to %u, load: %.2f", level, newLevel, _loadGovernor.getLoad());
+    }
     return oboe::DataCallbackResult::Continue;
 }
 
@@ -311,11 +511,21 @@ void LedfxEngine::onErrorAfterClose(oboe::AudioStream *oboeStream,
          oboe::convertToText(oboeStream->getDirection()),
          oboe::convertToText(error));
 
-    closeStreams();
+    std::lock_guard<std::mutex> lock(_streamLock);
+    // Ignore streams that were already replaced or closed by the engine.
+    if (!_isEffectOn || oboeStream != _recordingStream.get()) return;
 
-    // Restart the stream if the error is a disconnect.
+    // Reopen only the input if the error is a disconnect, the pipeline and the LED output keep running.
     if (error == oboe::Result::ErrorDisconnected) {
-        LOGI("Restarting LedfxEngine");
-        openStreams();
+        LOGI("Restarting input stream");
+        if (switchInput() != oboe::Result::OK) {
+            LOGE("Failed to reopen the input stream");
+        }
+    } else {
+        // The effect is off from here, so switching the input can't restart the callback without an output.
+        closeStreams();
+        stopOutput();
+        _frameLogRecorder.stop();
+        _isEffectOn = false;
     }
 }
@@ -22,21 +22,26 @@
 #include <string>
 #include <thread>
 #include <array>
-#include "AubioDspProcessor.h"
-#include "IDspProcessor.h"
+#include <atomic>
+#include <mutex>
+#include "AudioPipeline.h"
 #include "WLedDevice.h"
-
-#define SAMPLE_RATE 44100u
-#define FFT_SIZE 512u
-#define HOP_SIZE 192U  // same as frame size.
-#define FILTER_SIZE 24u
-#define MIN_FREQ_HZ 200u
-#define MAX_FREQ_HZ 4000u
-#define BYTES_PER_LED 3u
+#include "FrameLogRecorder.h"
+#include "FrameLogPlayer.h"
+#include "LoadGovernor.h"
+#include "EngineStats.h"
+#include "OutputSender.h"
+#include "SnapshotExchange.h"
+
+#define LOAD_HIGH 0.50f            // Callback load (processing time over deadline) considered as pressure.
+#define LOAD_LOW 0.20f             // Callback load considered as headroom.
+#define LOAD_STEP_DOWN_MS 250u     // Sustained pressure before lowering the quality.
+#define LOAD_STEP_UP_MS 3000u      // Sustained headroom before raising the quality.
 
 class LedfxEngine : public oboe::AudioStreamCallback {
 public:
-    LedfxEngine();
+    explicit LedfxEngine(std::shared_ptr<OutputSender> sender);
+    ~LedfxEngine();
 
     void setRecordingDeviceId(int32_t deviceId);
 
@@ -58,34 +63,112 @@ public:
     void onErrorBeforeClose(oboe::AudioStream *oboeStream, oboe::Result error) override;
     void onErrorAfterClose(oboe::AudioStream *oboeStream, oboe::Result error) override;
 
+    /**
+     * @param isStereo true to analyse left and right channels separately,
+     * rendering the left spectrum on the first half of the strip and the right one on the second half.
+     */
+    void setStereoAnalysis(bool isStereo);
+
+    /**
+     * @return the current quality level, transitions count and load in percent, see LoadGovernor.
+     */
+    std::array<int32_t, 3> getQualityStats() const;
+
+    /**
+     * @return the counters of the last audio callback, see EngineStats.
+     */
+    EngineStats::Values getEngineStats() const { return _stats.read(); }
+
+    /**
+     * @param isFixedPoint true to capture int16 PCM and analyse it in fixed point, false for the float path.
+     * @return true if it succeeds, it fails while the effect is on.
+     */
+    bool setFixedPointAnalysis(bool isFixedPoint);
+
+    /**
+     * @param bandCount number of log-frequency bands rendered across the strip, 0 to render the Mel bands.
+     * @return true if it succeeds, it fails while the effect is on.
+     */
+    bool setLogSpectrumBands(int32_t bandCount);
+
+    /**
+     * @param isMultiResolution true to analyse the bass with a long FFT and the highs with a short one,
+     * false for a single FFT. Only applies to the float analysis.
+     * @return true if it succeeds, it fails while the effect is on.
+     */
+    bool setMultiResolutionAnalysis(bool isMultiResolution);
+
+    /**
+     * @param path file to record the sent LED frames to while the effect is on, empty to stop recording.
+     * @return true if it succeeds, it fails while the effect is on.
+     */
+    bool setFrameLogPath(std::string path);
+
+    /**
+     * @param path frame log to send to the device with its recorded timing, no audio is captured.
+     * @param isLooping true to restart at the end of the log.
+     * @return true if it succeeds, it fails while the effect is on.
+     */
+    bool startReplay(std::string path, bool isLooping);
+    void stopReplay();
+
+    /**
+     * @param protocol the wire protocol used to send the LED frames, see WLedDevice::Protocol.
+     * @return true if it succeeds, it fails while the effect is on or a frame log is replayed.
+     */
+    bool setOutputProtocol(WLedDevice::Protocol protocol);
+
     bool setAudioApi(oboe::AudioApi);
+
+    /**
+     * @return the number of input stream switches and the output pause of the last one in us, see switchInput().
+     */
+    std::array<int64_t, 2> getInputSwitchStats() const;
     bool isAAudioRecommended(void);
     void updateConfig(std::string iPaddr, uint16_t portNum, size_t numLeds);
 
 private:
-    bool              _isEffectOn = false;
+    bool              _isEffectOn = false;  // Guarded by _streamLock, like the settings only allowed while it is off.
     int32_t           _recordingDeviceId = oboe::kUnspecified;
-    const oboe::AudioFormat _format = oboe::AudioFormat::Float; // for easier processing
+    oboe::AudioFormat _format = oboe::AudioFormat::Float; // for easier processing, I16 with the fixed point analysis
     oboe::AudioApi    _audioApi = oboe::AudioApi::AAudio;
     int32_t           _sampleRate = SAMPLE_RATE;
     const int32_t     _inputChannelCount = oboe::ChannelCount::Stereo;
 
-    std::unique_ptr<IDspProcessor> _dspProcessor;
+    AudioPipeline     _pipeline{SAMPLE_RATE, static_cast<size_t>(_inputChannelCount), 60u};
+    LoadGovernor      _loadGovernor{LOAD_HIGH, LOAD_LOW, LOAD_STEP_DOWN_MS, LOAD_STEP_UP_MS};
+    EngineStats       _stats;
+    EngineStats::Values _statsValues;       // Audio thread copy, published at the end of every callback.
+    int64_t           _fpsWindowFrames = 0;     // Audio frames of the current output rate window.
+    uint64_t          _fpsWindowSentFrames = 0u;
 
     std::shared_ptr<oboe::AudioStream> _recordingStream;
+    std::mutex        _streamLock;  // Serializes stream and setting changes between the JNI thread and Oboe's error thread.
+    std::atomic<int64_t> _inputSwitchStartNs{0};  // Start of the input switch waiting for its first callback, 0 if none.
+    std::atomic<int64_t> _lastInputSwitchUs{0};
+    std::atomic<int64_t> _inputSwitchCount{0};
 
-    std::shared_ptr<ExpFilter> _inVolFilter;
-    std::shared_ptr<ExpFilter> _melBankOutput;
-    std::shared_ptr<std::vector<uint8_t>> _ledData;
     std::shared_ptr<WLedDevice> _device;
+    std::shared_ptr<OutputSender> _sender;
+    std::shared_ptr<OutputSender::Output> _output;  // Registered with the sender while the effect is on.
+    SnapshotExchange<std::vector<uint8_t>> _ledData;  // Zeroed frames for a new LED count, adopted by the audio thread.
+
+    std::string       _frameLogPath;
+    FrameLogRecorder  _frameLogRecorder;
+    int64_t           _recordedAudioFrames = 0;  // Audio time of the recording, timestamps the logged frames.
+    FrameLogPlayer    _frameLogPlayer;
 
 
     oboe::Result openStreams();
 
+    oboe::Result switchInput();
+
     void closeStreams();
 
     void closeStream(std::shared_ptr<oboe::AudioStream> &stream);
 
+    void stopOutput();
+
     oboe::AudioStreamBuilder *setupCommonStreamParameters(
         oboe::AudioStreamBuilder *builder);
     oboe::AudioStreamBuilder *setupRecordingStreamParameters(
@@ -0,0 +1,71 @@
+#include <cassert>
+#include "LoadGovernor.h"
+
+/**
+ * Constructor for the LoadGovernor class.
+ *
+ * @param highLoad Smoothed load (processing time over deadline) above which the callback is under pressure.
+ * @param lowLoad Smoothed load below which the callback has headroom, must be below highLoad.
+ * @param stepDownHoldMs Audio time under pressure before stepping one quality level down.
+ * @param stepUpHoldMs Audio time with headroom before stepping one quality level up.
+ */
+LoadGovernor::LoadGovernor(float highLoad, float lowLoad, uint32_t stepDownHoldMs, uint32_t stepUpHoldMs) :
+        _highLoad(highLoad), _lowLoad(lowLoad),
+        _stepDownHoldNs(static_cast<int64_t>(stepDownHoldMs) * 1000000),
+        _stepUpHoldNs(static_cast<int64_t>(stepUpHoldMs) * 1000000) {
+    assert(lowLoad < highLoad && "Low load threshold must be below the high load threshold");
+}
+
+/**
+ * Accounts for one audio callback and steps the quality level if needed.
+ * Only one step is taken at a time, and the hold times restart after every transition,
+ * so the new level gets measured before the next decision.
+ *
+ * @param processingNs Time spent processing the callback.
+ * @param deadlineNs Audio duration of the callback buffer.
+ * @return true if the quality level changed.
+ */
+bool LoadGovernor::update(int64_t processingNs, int64_t deadlineNs) {
+    if (deadlineNs <= 0) return false;
+
+    // Exponential smoothing, so a single preempted callback doesn't count as pressure.
+    float load = _load.load(std::memory_order_relaxed);
+    load += (static_cast<float>(processingNs) / static_cast<float>(deadlineNs) - load) * 0.0625f;
+    _load.store(load, std::memory_order_relaxed);
+
+    if (load > _highLoad) {
+        _pressureNs += deadlineNs;
+        _headroomNs = 0;
+    } else if (load < _lowLoad) {
+        _headroomNs += deadlineNs;
+        _pressureNs = 0;
+    } else {
+        _pressureNs = 0;
+        _headroomNs = 0;
+    }
+
+    uint32_t level = _level.load(std::memory_order_relaxed);
+    if (_pressureNs >= _stepDownHoldNs && level + 1u < LevelCount) {
+        level++;
+    } else if (_headroomNs >= _stepUpHoldNs && level > Full) {
+        level--;
+    } else {
+        return false;
+    }
+
+    _pressureNs = 0;
+    _headroomNs = 0;
+    _level.store(level, std::memory_order_relaxed);
+    _transitionCount.fetch_add(1u, std::memory_order_relaxed);
+    return true;
+}
+
+/**
+ * Returns to full quality, to be called when the audio stream is (re)started.
+ */
+void LoadGovernor::reset() {
+    _pressureNs = 0;
+    _headroomNs = 0;
+    _load.store(0.0f, std::memory_order_relaxed);
+    _level.store(Full, std::memory_order_relaxed);
+}
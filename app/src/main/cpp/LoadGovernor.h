@@ -0,0 +1,51 @@
+#ifndef LEDFX_LOADGOVERNOR_H
+#define LEDFX_LOADGOVERNOR_H
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief CPU budget governor for the audio callback.
+ * Compares the processing time of every callback with its audio deadline, steps the quality level down
+ * under sustained pressure and back up once there is enough headroom again.
+ * update() is called from the audio thread, the getters can be called from any thread.
+ */
+class LoadGovernor {
+public:
+    /**
+     * Quality levels, each one keeps the savings of the previous ones.
+     */
+    enum Level : uint32_t {
+        Full = 0,    // Every hop analysed, every callback rendered and sent.
+        HalfFps,     // Render and send every other callback.
+        HalfHop,     // Spectrum computed every other hop.
+        Minimal,     // Half the Mel bands, stereo analysis falls back to mono.
+        LevelCount
+    };
+
+    LoadGovernor(float highLoad, float lowLoad, uint32_t stepDownHoldMs, uint32_t stepUpHoldMs);
+
+    bool update(int64_t processingNs, int64_t deadlineNs);
+
+    void reset();
+
+    uint32_t getLevel() const { return _level.load(std::memory_order_relaxed); }
+    uint32_t getTransitionCount() const { return _transitionCount.load(std::memory_order_relaxed); }
+    float getLoad() const { return _load.load(std::memory_order_relaxed); }
+
+private:
+    const float _highLoad;
+    const float _lowLoad;
+    const int64_t _stepDownHoldNs;
+    const int64_t _stepUpHoldNs;
+
+    std::atomic<uint32_t> _level{Full};
+    std::atomic<uint32_t> _transitionCount{0u};
+    std::atomic<float> _load{0.0f};  // Smoothed ratio of processing time over deadline.
+
+    int64_t _pressureNs = 0;  // Audio time spent continuously above _highLoad.
+    int64_t _headroomNs = 0;  // Audio time spent continuously below _lowLoad.
+};
+
+
+#endif //LEDFX_LOADGOVERNOR_H
@@ -0,0 +1,191 @@
+#include "LogSpectrum.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+/**
+ * @brief Builds the kernels of every band.
+ *
+ * @param winS The FFT size of the analysis, the power spectrum has winS / 2 + 1 bins.
+ * @param sampleRate The sample rate of the audio.
+ * @param fMin The center frequency of the first band.
+ * @param fMax The center frequency of the last band, lowered to fit below the Nyquist frequency.
+ * @param bandCount The number of bands, LOG_SPECTRUM_MIN_BANDS to LOG_SPECTRUM_MAX_BANDS, lowered to
+ * getResolvableBandCount().
+ * @param fineWinS The FFT size of the finer spectrum, 0 without one.
+ * @param fineSampleRate The sample rate the finer spectrum is computed at, a decimated rate.
+ * @param crossoverHz The bands centered below it also get kernels on the finer spectrum.
+ */
+LogSpectrum::LogSpectrum(size_t winS, float sampleRate, float fMin, float fMax, size_t bandCount,
+                         size_t fineWinS, float fineSampleRate, float crossoverHz) :
+        _binCount(winS / 2u + 1u),
+        _fineBinCount(0u == fineWinS ? 0u : fineWinS / 2u + 1u),
+        _levels(std::min(std::min<size_t>(std::max<size_t>(bandCount, LOG_SPECTRUM_MIN_BANDS), LOG_SPECTRUM_MAX_BANDS),
+                         getResolvableBandCount(winS, sampleRate, fMin, fMax, fineWinS, fineSampleRate, crossoverHz))) {
+    assert(_binCount < 65536u && _fineBinCount < 65536u && "Bins are stored in 16 bits");
+    assert((0u == fineWinS || crossoverHz < fineSampleRate / 2.0f) && "The crossover must be below the fine Nyquist frequency");
+    const size_t bands = _levels.size();
+    const double binHz = static_cast<double>(sampleRate) / static_cast<double>(winS);
+    const double low = std::max<double>(fMin, binHz);
+    const double high = std::max(low * 2.0, std::min<double>(fMax, sampleRate / 2.0 - binHz));
+
+    // Ratio between neighbouring centers, the band edges sit halfway between centers in log frequency.
+    const double logStep = std::log(high / low) / static_cast<double>(bands - 1u);
+    auto center = [&](double band) { return low * std::exp(logStep * band); };
+
+    size_t band = 0;
+    for (; band < bands; band++) {
+        const double widthBins = (center(band + 0.5) - center(band - 0.5)) / binHz;
+        if (widthBins >= LOG_SPECTRUM_GROUP_BINS) break;
+        addKernel(_kernels, center(band), center(band - 1.0), center(band + 1.0), logStep, binHz, _binCount);
+    }
+
+    // The bottom bands again on the finer spectrum. The coarse kernels stay, for when it isn't given.
+    if (0u != _fineBinCount) {
+        const double fineBinHz = static_cast<double>(fineSampleRate) / static_cast<double>(fineWinS);
+        for (size_t fine = 0; fine < band && center(fine) < crossoverHz; fine++) {
+            addKernel(_fineKernels, center(fine), center(fine - 1.0), center(fine + 1.0), logStep, fineBinHz,
+                      _fineBinCount);
+        }
+    }
+
+    // Bands are wider further up, so once a band spans enough bins all the following ones do too.
+    if (band < bands) {
+        for (size_t edge = band; edge <= bands; edge++) {
+            const auto bin = static_cast<size_t>(std::lround(center(static_cast<double>(edge) - 0.5) / binHz));
+            const size_t previous = _groupEdges.empty() ? 0u : _groupEdges.back() + 1u;
+            _groupEdges.push_back(static_cast<uint16_t>(std::min(std::max(bin, previous), _binCount)));
+        }
+    }
+}
+
+/**
+ * @brief Appends the kernel of a narrow band: a triangle in log frequency, 1 at the center and 0 at the
+ * neighbours' centers, so neighbouring triangles add up to 1 and every bin in the range is counted once overall.
+ * A band narrower than a bin interpolates the two bins around its center instead.
+ *
+ * @param kernels The kernels to append to.
+ * @param centerHz The center frequency of the band.
+ * @param lowHz The center frequency of the band below.
+ * @param highHz The center frequency of the band above.
+ * @param logStep The log of the ratio between neighbouring centers.
+ * @param binHz The bin spacing of the spectrum.
+ * @param binCount The number of bins of the spectrum.
+ */
+void LogSpectrum::addKernel(Kernels& kernels, double centerHz, double lowHz, double highHz, double logStep,
+                            double binHz, size_t binCount) {
+    const size_t first = static_cast<size_t>(std::ceil(lowHz / binHz));
+    const size_t last = std::min(static_cast<size_t>(std::floor(highHz / binHz)), binCount - 1u);
+    const size_t start = kernels.bins.size();
+    double sum = 0.0;
+    for (size_t bin = std::max<size_t>(first, 1u); bin <= last; bin++) {
+        const double weight = 1.0 - std::fabs(std::log(static_cast<double>(bin) * binHz / centerHz)) / logStep;
+        if (weight <= 0.0) continue;
+        kernels.bins.push_back(static_cast<uint16_t>(bin));
+        kernels.weights.push_back(static_cast<float>(weight));
+        sum += weight;
+    }
+
+    if (kernels.bins.size() - start < 2u) {
+        kernels.bins.resize(start);
+        kernels.weights.resize(start);
+        const double position = centerHz / binHz;
+        const size_t below = std::min(static_cast<size_t>(position), binCount - 2u);
+        const double fraction = std::min(position - static_cast<double>(below), 1.0);
+        kernels.bins.push_back(static_cast<uint16_t>(below));
+        kernels.bins.push_back(static_cast<uint16_t>(below + 1u));
+        kernels.weights.push_back(static_cast<float>(1.0 - fraction));
+        kernels.weights.push_back(static_cast<float>(fraction));
+    } else {
+        for (size_t tap = start; tap < kernels.weights.size(); tap++) {
+            kernels.weights[tap] = static_cast<float>(kernels.weights[tap] / sum);
+        }
+    }
+    kernels.offsets.push_back(static_cast<uint32_t>(kernels.bins.size()));
+}
+
+/**
+ * @brief The largest band count the FFT resolves over a range: one band per bin between fMin and fMax, the same
+ * range as the constructor, but never below LOG_SPECTRUM_MIN_BANDS. Above it, bands would only interpolate the
+ * same bins. With FFT_SIZE 512 and 100 Hz to 16 kHz that is 184 bands at 44.1 kHz and 169 at 48 kHz.
+ * With a finer spectrum, its bins count below the crossover instead of the coarse ones.
+ *
+ * @param winS The FFT size of the analysis.
+ * @param sampleRate The sample rate of the audio.
+ * @param fMin The center frequency of the first band.
+ * @param fMax The center frequency of the last band.
+ * @param fineWinS The FFT size of the finer spectrum, 0 without one.
+ * @param fineSampleRate The sample rate the finer spectrum is computed at.
+ * @param crossoverHz The frequency below which the finer spectrum is used.
+ * @return The number of bins in the range.
+ */
+size_t LogSpectrum::getResolvableBandCount(size_t winS, float sampleRate, float fMin, float fMax,
+                                           size_t fineWinS, float fineSampleRate, float crossoverHz) {
+    const double binHz = static_cast<double>(sampleRate) / static_cast<double>(winS);
+    const double low = std::max<double>(fMin, binHz);
+    const double high = std::max(low * 2.0, std::min<double>(fMax, sampleRate / 2.0 - binHz));
+    auto countBins = [](double from, double to, double spacing) {
+        const auto first = static_cast<size_t>(std::ceil(from / spacing));
+        const auto last = static_cast<size_t>(std::floor(to / spacing));
+        return last + 1u - std::min(first, last + 1u);
+    };
+
+    size_t bins;
+    if (0u != fineWinS && crossoverHz > low) {
+        const double fineBinHz = static_cast<double>(fineSampleRate) / static_cast<double>(fineWinS);
+        const double split = std::min<double>(crossoverHz, high);
+        // The fine bins stop short of the crossover, which belongs to the coarse range.
+        bins = countBins(low, std::nextafter(split, 0.0), fineBinHz) + (split < high ? countBins(split, high, binHz) : 0u);
+    } else {
+        bins = countBins(low, high, binHz);
+    }
+    return std::max<size_t>(bins, LOG_SPECTRUM_MIN_BANDS);
+}
+
+/**
+ * @return The power of a narrow band, the weighted sum of its kernel taps.
+ */
+float LogSpectrum::applyKernel(const Kernels& kernels, size_t band, const float* power) {
+    float acc = 0.0f;
+    for (uint32_t tap = kernels.offsets[band]; tap < kernels.offsets[band + 1u]; tap++) {
+        acc += kernels.weights[tap] * power[kernels.bins[tap]];
+    }
+    return acc;
+}
+
+/**
+ * @brief Computes the band levels of one spectrum and smooths them.
+ *
+ * @param power The squared FFT magnitudes, getBinCount() long.
+ * @param finePower The squared magnitudes of the finer spectrum, getFineBinCount() long, on the same scale
+ * for a sine, or nullptr to compute every band from power.
+ * @param levels The ExpFilter to update with the levels, getBandCount() long, 0 at LOG_SPECTRUM_FLOOR_DB
+ * and 1 at LOG_SPECTRUM_RANGE_DB above it.
+ */
+void LogSpectrum::process(const float* power, const float* finePower, ExpFilter& levels) {
+    auto toLevel = [](float bandPower) {
+        const float db = 10.0f * std::log10(bandPower + 1e-12f);
+        return std::min(std::max((db - LOG_SPECTRUM_FLOOR_DB) / LOG_SPECTRUM_RANGE_DB, 0.0f), 1.0f);
+    };
+
+    const size_t fineBands = finePower ? getFineBandCount() : 0u;
+    const size_t kernelBands = _kernels.offsets.size() - 1u;
+    for (size_t band = 0; band < fineBands; band++) {
+        _levels[band] = toLevel(applyKernel(_fineKernels, band, finePower));
+    }
+    for (size_t band = fineBands; band < kernelBands; band++) {
+        _levels[band] = toLevel(applyKernel(_kernels, band, power));
+    }
+
+    for (size_t group = 0; group + 1u < _groupEdges.size(); group++) {
+        const uint16_t first = _groupEdges[group];
+        const uint16_t end = _groupEdges[group + 1u];
+        float acc = 0.0f;
+        for (uint16_t bin = first; bin < end; bin++) {
+            acc += power[bin];
+        }
+        _levels[kernelBands + group] = toLevel(end > first ? acc / static_cast<float>(end - first) : 0.0f);
+    }
+
+    levels.update(_levels.data(), static_cast<uint32_t>(_levels.size()));
+}
@@ -0,0 +1,88 @@
+#ifndef LEDFX_LOGSPECTRUM_H
+#define LEDFX_LOGSPECTRUM_H
+
+#include <cstdint>
+#include <vector>
+#include "ExpFilter.h"
+
+#define LOG_SPECTRUM_MIN_BANDS 16u
+#define LOG_SPECTRUM_MAX_BANDS 512u
+#define LOG_SPECTRUM_MIN_FREQ_HZ 100.0f
+#define LOG_SPECTRUM_MAX_FREQ_HZ 16000.0f
+#define LOG_SPECTRUM_GROUP_BINS 4.0f    // Band width, in FFT bins, from which a band is a plain bin group.
+#define LOG_SPECTRUM_FLOOR_DB (-30.0f)  // Band power mapped to a level of 0.
+#define LOG_SPECTRUM_RANGE_DB 50.0f     // Band power range mapped to levels 0 to 1.
+
+/**
+ * @brief Log-frequency spectrum with many more bands than the Mel filter bank, for long LED strips.
+ * The band centers are spaced geometrically, like a constant-Q transform, and every band is computed from
+ * the power spectrum of the analysis FFT with a precomputed sparse kernel:
+ * - narrow bands, at the bottom of the range, use a triangle in log frequency over the few bins between their
+ *   neighbours' centers, or interpolate the two bins around their center when they are narrower than a bin,
+ * - wide bands, in the top octaves, are the mean of a contiguous group of bins, each bin belonging to one group.
+ * So the cost is a few multiply-adds per band instead of a dense row of the filter bank per band.
+ * Optionally the bands centered below a crossover also get kernels on a finer spectrum, like the long FFT of the
+ * multi-resolution analysis, which process() uses when it is given that spectrum.
+ * The band count is capped to the number of FFT bins in the range, see getResolvableBandCount(): more bands
+ * would only interpolate the same bins.
+ * process() doesn't allocate and can run on the audio thread.
+ */
+class LogSpectrum {
+public:
+    LogSpectrum(size_t winS, float sampleRate, float fMin, float fMax, size_t bandCount,
+                size_t fineWinS = 0u, float fineSampleRate = 0.0f, float crossoverHz = 0.0f);
+
+    void process(const float* power, ExpFilter& levels) { process(power, nullptr, levels); }
+
+    void process(const float* power, const float* finePower, ExpFilter& levels);
+
+    size_t getBandCount() const { return _levels.size(); }
+
+    static size_t getResolvableBandCount(size_t winS, float sampleRate, float fMin, float fMax,
+                                         size_t fineWinS = 0u, float fineSampleRate = 0.0f, float crossoverHz = 0.0f);
+
+    /**
+     * @return the number of FFT bins of the power spectrum process() takes, winS / 2 + 1.
+     */
+    size_t getBinCount() const { return _binCount; }
+
+    /**
+     * @return the number of bins of the finer spectrum process() can take, fineWinS / 2 + 1, 0 without one.
+     */
+    size_t getFineBinCount() const { return _fineBinCount; }
+
+    /**
+     * @return the number of bands taken from the finer spectrum when it is given, the bottom ones.
+     */
+    size_t getFineBandCount() const { return _fineKernels.offsets.size() - 1u; }
+
+    /**
+     * @return the number of bands computed as bin groups, the top ones.
+     */
+    size_t getGroupedBandCount() const { return _groupEdges.empty() ? 0u : _groupEdges.size() - 1u; }
+
+private:
+    // Kernels of the narrow bands, in compressed sparse rows: the taps of band j are
+    // [offsets[j], offsets[j + 1]), their weights sum to 1.
+    struct Kernels {
+        std::vector<uint32_t> offsets{0u};
+        std::vector<uint16_t> bins;
+        std::vector<float> weights;
+    };
+
+    const size_t _binCount;
+    const size_t _fineBinCount;
+    Kernels _kernels;
+    Kernels _fineKernels;  // The bottom bands again, on the finer spectrum.
+    // Bin groups of the wide bands, the group of band _kernels.offsets.size() - 1 + i is
+    // [_groupEdges[i], _groupEdges[i + 1]).
+    std::vector<uint16_t> _groupEdges;
+    std::vector<float> _levels;  // Levels of the latest spectrum, before smoothing.
+
+    static void addKernel(Kernels& kernels, double centerHz, double lowHz, double highHz, double logStep,
+                          double binHz, size_t binCount);
+    static float applyKernel(const Kernels& kernels, size_t band, const float* power);
+};
+
+
+#endif //LEDFX_LOGSPECTRUM_H
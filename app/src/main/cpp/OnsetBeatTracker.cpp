@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <cmath>
+#include "logging_macros.h"
+#include "OnsetBeatTracker.h"
+
+/**
+ * Constructor for the OnsetBeatTracker class.
+ * Sets up the peak picker and the beat tracker the same way aubio_tempo does, but without its own phase vocoder.
+ *
+ * @param hopS The hop size, one detection value is expected per hop.
+ * @param sampleRate The sample rate of the audio.
+ */
+OnsetBeatTracker::OnsetBeatTracker(const size_t hopS, const float sampleRate) {
+    _onsetValue = new_fvec(1);
+    _peakPicker = new_aubio_peakpicker();
+    aubio_peakpicker_set_threshold(_peakPicker, 0.3f);
+    _peakOutput = new_fvec(1);
+
+    // The detection function window covers ~5.8 seconds and the tracker runs every quarter of it.
+    uint_t dfLength = 1u;
+    while (dfLength < static_cast<uint_t>(std::lround(5.8f * sampleRate / hopS))) dfLength <<= 1u;
+    _dfStep = dfLength / 4u;
+    _dfFrame = new_fvec(dfLength);
+    _beatOutput = new_fvec(_dfStep);
+    _beatTracker = new_aubio_beattracking(dfLength, hopS, sampleRate);
+
+    LOGI("Beat tracker initialized with detection window: %u hops, step: %u hops", dfLength, _dfStep);
+}
+
+/**
+ * Picks onsets from the detection value of a new hop, then feeds the thresholded value to the beat tracker.
+ * Onset and beat flags are only ever set here, the caller clears them when it starts a new buffer.
+ *
+ * @param onsetValue The onset detection value (e.g. spectral flux) of the hop.
+ * @param features The features to update.
+ */
+void OnsetBeatTracker::process(const float onsetValue, AudioFeatures& features) {
+    _onsetValue->data[0] = onsetValue;
+    aubio_peakpicker_do(_peakPicker, _onsetValue, _peakOutput);
+
+    features.flux = onsetValue;
+    features.isOnset = features.isOnset || _peakOutput->data[0] > 0.0f;
+
+    trackBeat(features);
+}
+
+/**
+ * Accounts for a hop without a new detection value, the last thresholded value is repeated
+ * so the beat tracker keeps its timing.
+ *
+ * @param features The features to update.
+ */
+void OnsetBeatTracker::hold(AudioFeatures& features) {
+    trackBeat(features);
+}
+
+/**
+ * Runs the causal beat tracker on the onset detection function, mirroring aubio_tempo_do.
+ * The tracker is executed once every _dfStep hops, it predicts the beat positions of the next step,
+ * and each following hop checks whether it falls on one of those predicted positions.
+ *
+ * @param features The features to update.
+ */
+void OnsetBeatTracker::trackBeat(AudioFeatures& features) {
+    const uint_t dfLength = _dfFrame->length;
+
+    if (_blockPos == static_cast<sint_t>(_dfStep) - 1) {
+        aubio_beattracking_do(_beatTracker, _dfFrame, _beatOutput);
+        // Rotate the detection function window by one step.
+        std::copy(_dfFrame->data + _dfStep, _dfFrame->data + dfLength, _dfFrame->data);
+        std::fill(_dfFrame->data + dfLength - _dfStep, _dfFrame->data + dfLength, 0.0f);
+        _blockPos = -1;
+    }
+    _blockPos++;
+
+    _dfFrame->data[dfLength - _dfStep + _blockPos] = aubio_peakpicker_get_thresholded_input(_peakPicker)->data[0];
+
+    // First element holds the number of predicted beats plus one, followed by their positions in hops.
+    for (uint_t i = 1; i < static_cast<uint_t>(_beatOutput->data[0]); i++) {
+        if (_blockPos == static_cast<sint_t>(std::floor(_beatOutput->data[i]))) {
+            features.isBeat = true;
+            break;
+        }
+    }
+    features.bpm = aubio_beattracking_get_bpm(_beatTracker);
+    features.bpmConfidence = aubio_beattracking_get_confidence(_beatTracker);
+}
+
+/**
+ * Destructor for the OnsetBeatTracker class.
+ */
+OnsetBeatTracker::~OnsetBeatTracker() {
+    del_aubio_beattracking(_beatTracker);
+    del_fvec(_beatOutput);
+    del_fvec(_dfFrame);
+    del_fvec(_peakOutput);
+    del_aubio_peakpicker(_peakPicker);
+    del_fvec(_onsetValue);
+}
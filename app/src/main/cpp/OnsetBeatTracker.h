@@ -0,0 +1,39 @@
+#ifndef LEDFX_ONSETBEATTRACKER_H
+#define LEDFX_ONSETBEATTRACKER_H
+
+#include <cstddef>
+#include "types.h"
+#include "fvec.h"
+#include "onset/peakpicker.h"
+#include "tempo/beattracking.h"
+#include "AudioFeatures.h"
+
+/**
+ * @brief Onset picking and causal beat tracking on a per-hop onset detection value.
+ * Works on any detection function, so every DSP processor can feed it from the spectrum it already computed.
+ */
+class OnsetBeatTracker {
+public:
+    OnsetBeatTracker(const size_t hopS, const float sampleRate);
+    OnsetBeatTracker(const OnsetBeatTracker&) = delete;
+    OnsetBeatTracker& operator=(const OnsetBeatTracker&) = delete;
+    ~OnsetBeatTracker();
+
+    void process(const float onsetValue, AudioFeatures& features);
+    void hold(AudioFeatures& features);
+
+private:
+    fvec_t* _onsetValue = nullptr;
+    aubio_peakpicker_t* _peakPicker = nullptr;
+    fvec_t* _peakOutput = nullptr;
+    aubio_beattracking_t* _beatTracker = nullptr;
+    fvec_t* _dfFrame = nullptr;    // Window of past onset detection values fed to the beat tracker.
+    fvec_t* _beatOutput = nullptr;
+    uint_t _dfStep = 0u;           // Hops between two beat tracker runs.
+    sint_t _blockPos = 0;          // Position of the current hop inside the step.
+
+    void trackBeat(AudioFeatures& features);
+};
+
+
+#endif //LEDFX_ONSETBEATTRACKER_H
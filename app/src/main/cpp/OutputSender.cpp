@@ -0,0 +1,196 @@
+#include <logging_macros.h>
+
+#include "OutputSender.h"
+#include <algorithm>
+#include <cerrno>
+
+/**
+ * @brief Prepares the frames of an output.
+ *
+ * @param sender The sender to wake up on every submitted frame.
+ * @param device The device, already activated.
+ * @param frameBytes The expected frame size, reserved up front.
+ */
+OutputSender::Output::Output(OutputSender& sender, std::shared_ptr<WLedDevice> device, size_t frameBytes) :
+        _sender(sender), _device(std::move(device)), _reservedBytes(frameBytes) {
+    for (std::vector<uint8_t>& frame : _frames) {
+        frame.reserve(frameBytes);
+    }
+}
+
+/**
+ * @brief Announces a larger frame size, from any thread. The sender thread grows each frame to it the next time
+ * it holds that frame, so the rendering thread never allocates.
+ *
+ * @param frameBytes The frame size of the new LED count.
+ */
+void OutputSender::Output::reserve(size_t frameBytes) {
+    size_t reserved = _reservedBytes.load(std::memory_order_relaxed);
+    while (reserved < frameBytes &&
+           !_reservedBytes.compare_exchange_weak(reserved, frameBytes, std::memory_order_relaxed)) {}
+}
+
+/**
+ * @brief Hands a rendered frame to the sender, without waiting and without allocating.
+ * The frame is copied into the storage reserved for it. A frame larger than that storage is dropped, and its empty
+ * slot is still handed over, so the sender grows it, see reserve().
+ *
+ * @param leds The RGB bytes of the frame, copied.
+ * @param numBytes The number of bytes.
+ *
+ * @return true if the previous frame was picked up by the sender, false if it was dropped in favour of this one.
+ */
+bool OutputSender::Output::submit(const uint8_t* leds, size_t numBytes) {
+    std::vector<uint8_t>& frame = _frames[_back];
+    if (numBytes <= frame.capacity()) {
+        frame.resize(numBytes);
+        std::copy(leds, leds + numBytes, frame.begin());
+    } else {
+        frame.clear();
+        reserve(numBytes);
+    }
+    const uint8_t previous = _ready.exchange(static_cast<uint8_t>(_back | NEW_FRAME), std::memory_order_acq_rel);
+    _back = static_cast<uint8_t>(previous & ~NEW_FRAME);
+    int64_t noWakeup = 0;
+    _sender._wakeupNs.compare_exchange_strong(noWakeup, WakeupLatency::now(), std::memory_order_relaxed);
+    sem_post(&_sender._wakeup);
+
+    const bool isDropped = 0u != (previous & NEW_FRAME);
+    if (isDropped) {
+        _droppedCount.fetch_add(1u, std::memory_order_relaxed);
+    }
+    return !isDropped;
+}
+
+/**
+ * @brief Takes the latest submitted frame if it wasn't sent yet, sender thread only.
+ * The frame is grown to the reserved size here, before the device's packets point into it.
+ *
+ * @return true if there is a new frame to encode.
+ */
+bool OutputSender::Output::pickUp() {
+    if (!hasNewFrame()) return false;
+
+    _front = static_cast<uint8_t>(_ready.exchange(_front, std::memory_order_acq_rel) & ~NEW_FRAME);
+    _frames[_front].reserve(_reservedBytes.load(std::memory_order_relaxed));
+    return true;
+}
+
+/**
+ * @brief Encodes the picked up frame into the device's packets, an empty frame was dropped by submit().
+ */
+void OutputSender::Output::encode() {
+    const std::vector<uint8_t>& frame = _frames[_front];
+    if (frame.empty()) {
+        _isEncoded = false;
+        _droppedCount.fetch_add(1u, std::memory_order_relaxed);
+        return;
+    }
+    const WLedDevice::Config* config = _device->acquireConfig();
+    _isEncoded = config && _device->encode(*config, frame.data(), frame.size());
+    if (!_isEncoded) {
+        _droppedCount.fetch_add(1u, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Sends the encoded frame, if any.
+ */
+void OutputSender::Output::send() {
+    if (!_isEncoded) return;
+    _isEncoded = false;
+    if (_device->send()) {
+        _sentCount.fetch_add(1u, std::memory_order_relaxed);
+    } else {
+        _droppedCount.fetch_add(1u, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Starts the sender thread, it sleeps until a frame is submitted.
+ *
+ * @param workerCount The number of pool threads helping the sender thread when several outputs have a new frame.
+ */
+OutputSender::OutputSender(size_t workerCount) : _pool(workerCount) {
+    sem_init(&_wakeup, 0, 0u);
+    _thread = std::thread(&OutputSender::run, this);
+}
+
+OutputSender::~OutputSender() {
+    _shouldStop.store(true, std::memory_order_release);
+    sem_post(&_wakeup);
+    _thread.join();
+    sem_destroy(&_wakeup);
+}
+
+/**
+ * @brief Registers a device, the sender thread becomes its flushing thread until the output is removed.
+ *
+ * @param device The device, already activated.
+ * @param frameBytes The expected frame size, so submitting frames of that size never allocates.
+ *
+ * @return The output to submit the device's frames to.
+ */
+std::shared_ptr<OutputSender::Output> OutputSender::addOutput(std::shared_ptr<WLedDevice> device, size_t frameBytes) {
+    std::shared_ptr<Output> output(new Output(*this, std::move(device), frameBytes));
+    std::lock_guard<std::mutex> lock(_outputsLock);
+    _outputs.push_back(output);
+    _pickedUp.reserve(_outputs.size());
+    return output;
+}
+
+/**
+ * @brief Unregisters an output, waiting for a flush in progress. The device can be deactivated afterwards.
+ *
+ * @param output The output returned by addOutput(), nullptr is ignored.
+ */
+void OutputSender::removeOutput(const std::shared_ptr<Output>& output) {
+    std::lock_guard<std::mutex> lock(_outputsLock);
+    _outputs.erase(std::remove(_outputs.begin(), _outputs.end(), output), _outputs.end());
+}
+
+/**
+ * @brief Changes the priority and affinity of the sender thread and of its pool. The sender thread applies
+ * it when it wakes up next, it is woken up right away.
+ *
+ * @param scheduling The scheduling of the sender thread and the pool workers.
+ */
+void OutputSender::setScheduling(const ThreadScheduling& scheduling) {
+    _scheduling.set(scheduling);
+    sem_post(&_wakeup);
+    _pool.setScheduling(scheduling);
+}
+
+/**
+ * @brief Sender thread loop, flushes the new frames of all outputs every time it is woken up.
+ * All the new frames are encoded before the first one is sent, which is the frame barrier between the devices.
+ */
+void OutputSender::run() {
+    uint32_t schedulingGeneration = 0u;
+    while (true) {
+        if (0 != sem_wait(&_wakeup)) {
+            if (EINTR != errno) LOGE("Output sender failed to wait for frames");
+            continue;
+        }
+        if (_shouldStop.load(std::memory_order_acquire)) break;
+
+        _scheduling.applyIfChanged(schedulingGeneration);
+        const int64_t wakeupNs = _wakeupNs.exchange(0, std::memory_order_relaxed);
+        if (0 != wakeupNs) _wakeupLatency.record(WakeupLatency::now() - wakeupNs);
+
+        std::lock_guard<std::mutex> lock(_outputsLock);
+        _pickedUp.clear();
+        for (const std::shared_ptr<Output>& output : _outputs) {
+            if (output->pickUp()) _pickedUp.push_back(output.get());
+        }
+        if (!_pickedUp.empty()) {
+            _batchCount.fetch_add(1u, std::memory_order_relaxed);
+            _batchedFrameCount.fetch_add(_pickedUp.size(), std::memory_order_relaxed);
+        }
+
+        auto encode = [this](size_t index) { _pickedUp[index]->encode(); };
+        _pool.run(_pickedUp.size(), encode);
+        auto send = [this](size_t index) { _pickedUp[index]->send(); };
+        _pool.run(_pickedUp.size(), send);
+    }
+}
@@ -0,0 +1,108 @@
+#ifndef LEDFX_OUTPUTSENDER_H
+#define LEDFX_OUTPUTSENDER_H
+
+#include <semaphore.h>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "RenderPool.h"
+#include "WLedDevice.h"
+
+/**
+ * @brief Sends the LED frames of every engine from one shared thread, so the audio callbacks never touch a socket.
+ * Each running engine registers an Output for its device and submits its frames to it, lock free. The sender
+ * wakes up on every submitted frame and flushes the latest frame of each output, a frame that is replaced
+ * before it was sent is dropped.
+ * With several outputs the frames are encoded in parallel on a RenderPool, and sent in parallel once all of
+ * them are encoded, so the devices update together.
+ */
+class OutputSender {
+public:
+    /**
+     * @brief One device fed by one engine, the frames are handed over through a triple buffer.
+     * submit() is called by the engine's rendering thread only, the sender thread owns the device until removed.
+     */
+    class Output {
+    public:
+        bool submit(const uint8_t* leds, size_t numBytes);
+        void reserve(size_t frameBytes);
+
+        uint64_t getSentCount() const { return _sentCount.load(std::memory_order_relaxed); }
+        uint64_t getDroppedCount() const { return _droppedCount.load(std::memory_order_relaxed); }
+
+    private:
+        friend class OutputSender;
+
+        static constexpr uint8_t NEW_FRAME = 4u;  // Flag of _ready, the frame was not picked up by the sender yet.
+
+        OutputSender& _sender;
+        std::shared_ptr<WLedDevice> _device;
+        std::array<std::vector<uint8_t>, 3> _frames;
+        uint8_t _back = 0u;                   // Rendering thread side, the frame being written.
+        uint8_t _front = 1u;                  // Sender side, the frame being sent.
+        std::atomic<uint8_t> _ready{2u};      // The last complete frame, with NEW_FRAME until it is picked up.
+        std::atomic<size_t> _reservedBytes{0u};  // Capacity the sender grows every frame to, see reserve().
+        std::atomic<uint64_t> _sentCount{0u};
+        std::atomic<uint64_t> _droppedCount{0u};
+
+        bool _isEncoded = false;              // Sender side, the front frame is encoded and waits to be sent.
+
+        Output(OutputSender& sender, std::shared_ptr<WLedDevice> device, size_t frameBytes);
+        bool hasNewFrame() const { return 0u != (_ready.load(std::memory_order_relaxed) & NEW_FRAME); }
+        bool pickUp();
+        void encode();
+        void send();
+    };
+
+    explicit OutputSender(size_t workerCount);
+    OutputSender(const OutputSender&) = delete;
+    OutputSender& operator=(const OutputSender&) = delete;
+    ~OutputSender();
+
+    std::shared_ptr<Output> addOutput(std::shared_ptr<WLedDevice> device, size_t frameBytes);
+    void removeOutput(const std::shared_ptr<Output>& output);
+
+    void setScheduling(const ThreadScheduling& scheduling);
+
+    /**
+     * @return the policy the sender thread got from the last setScheduling().
+     */
+    ThreadScheduling::Policy getPolicy() const { return _scheduling.getPolicy(); }
+
+    /**
+     * @return the time from the first frame submitted to the sender thread running.
+     */
+    const WakeupLatency& getWakeupLatency() const { return _wakeupLatency; }
+
+    const RenderPool& getPool() const { return _pool; }
+
+    /**
+     * @return the mean number of outputs flushed together per wakeup with at least one new frame.
+     */
+    double getMeanBatchSize() const {
+        const uint64_t batches = _batchCount.load(std::memory_order_relaxed);
+        return 0u == batches ? 0.0 : static_cast<double>(_batchedFrameCount.load(std::memory_order_relaxed)) / batches;
+    }
+
+private:
+    std::mutex _outputsLock;  // Held while sending, so a removed output is never flushed again.
+    std::vector<std::shared_ptr<Output>> _outputs;
+    std::vector<Output*> _pickedUp;  // Sender thread, the outputs with a new frame, reserved for all outputs.
+    sem_t _wakeup;            // Posted by every submit, lock free and safe on the audio thread.
+    std::atomic<bool> _shouldStop{false};
+    std::atomic<int64_t> _wakeupNs{0};  // When the first frame since the last wakeup was submitted, 0 if none.
+    WakeupLatency _wakeupLatency;
+    SchedulingUpdate _scheduling;  // Applied by the sender thread when it wakes up next.
+    std::atomic<uint64_t> _batchCount{0u};
+    std::atomic<uint64_t> _batchedFrameCount{0u};
+    RenderPool _pool;
+    std::thread _thread;
+
+    void run();
+};
+
+
+#endif //LEDFX_OUTPUTSENDER_H
@@ -0,0 +1,159 @@
+#include <logging_macros.h>
+
+#include "RenderPool.h"
+#include <algorithm>
+#include <cerrno>
+
+/**
+ * @brief Starts the worker threads, they sleep until a frame needs them.
+ *
+ * @param workerCount The number of threads besides the calling one, at most RENDER_POOL_MAX_WORKERS. 0 runs
+ * every task on the calling thread.
+ */
+RenderPool::RenderPool(size_t workerCount) :
+        _ranges(1u + std::min<size_t>(workerCount, RENDER_POOL_MAX_WORKERS)) {
+    sem_init(&_wakeup, 0, 0u);
+    for (size_t self = 1; self < _ranges.size(); self++) {
+        _workers.emplace_back(&RenderPool::runWorker, this, self);
+    }
+}
+
+RenderPool::~RenderPool() {
+    _shouldStop.store(true, std::memory_order_release);
+    for (size_t i = 0; i < _workers.size(); i++) {
+        sem_post(&_wakeup);
+    }
+    for (std::thread& worker : _workers) {
+        worker.join();
+    }
+    sem_destroy(&_wakeup);
+}
+
+/**
+ * @brief Distributes the tasks of a frame, wakes the workers needed, helps them and waits for the last task.
+ */
+void RenderPool::runTasks(size_t taskCount, TaskFunction function, void* context) {
+    if (0u == taskCount) return;
+    if (1u == taskCount || _workers.empty()) {
+        for (size_t index = 0; index < taskCount; index++) function(context, index);
+        return;
+    }
+
+    // The previous frame is complete, no thread reads the function until it claims a task of the new ranges.
+    _function = function;
+    _context = context;
+    _remainingTasks.store(taskCount, std::memory_order_relaxed);
+    // Before the ranges, so a worker that claims a task of this frame sees its wakeup time.
+    _wakeupNs.store(WakeupLatency::now(), std::memory_order_relaxed);
+    _frameGeneration.fetch_add(1u, std::memory_order_release);
+    const size_t threadCount = std::min(_ranges.size(), taskCount);
+    for (size_t thread = 0; thread < _ranges.size(); thread++) {
+        const uint64_t first = thread < threadCount ? taskCount * thread / threadCount : 0u;
+        const uint64_t end = thread < threadCount ? taskCount * (thread + 1u) / threadCount : 0u;
+        _ranges[thread].range.store(first << 32 | end, std::memory_order_release);
+    }
+    for (size_t i = 1; i < threadCount; i++) {
+        sem_post(&_wakeup);
+    }
+
+    work(0u);
+
+    std::unique_lock<std::mutex> lock(_doneLock);
+    _done.wait(lock, [this] { return 0u == _remainingTasks.load(std::memory_order_acquire); });
+}
+
+/**
+ * @brief Runs the tasks of a thread's own range, then steals from the other ranges until none is left.
+ *
+ * @param self The range of the calling thread.
+ *
+ * @return The number of tasks the thread ran.
+ */
+size_t RenderPool::work(size_t self) {
+    size_t index;
+    size_t completed = 0u;
+    while (claim(self, false, index)) {
+        _function(_context, index);
+        completed++;
+    }
+    for (size_t i = 1; i < _ranges.size(); i++) {
+        const size_t victim = (self + i) % _ranges.size();
+        while (claim(victim, true, index)) {
+            _stealCount.fetch_add(1u, std::memory_order_relaxed);
+            _function(_context, index);
+            completed++;
+        }
+    }
+
+    if (0u != completed && completed == _remainingTasks.fetch_sub(completed, std::memory_order_acq_rel)) {
+        // Last task of the frame, the lock makes sure the caller is either waiting or hasn't checked yet.
+        { std::lock_guard<std::mutex> lock(_doneLock); }
+        _done.notify_one();
+    }
+    return completed;
+}
+
+/**
+ * @brief Claims a task of a range, lock free.
+ *
+ * @param owner The range.
+ * @param isSteal true to take the last task, as a thief, false to take the first one, as the owner.
+ * @param index Receives the claimed task.
+ *
+ * @return true if a task was claimed, false if the range is empty.
+ */
+bool RenderPool::claim(size_t owner, bool isSteal, size_t& index) {
+    std::atomic<uint64_t>& range = _ranges[owner].range;
+    uint64_t current = range.load(std::memory_order_acquire);
+    while (true) {
+        const uint64_t first = current >> 32;
+        const uint64_t end = current & 0xFFFFFFFFu;
+        if (first >= end) return false;
+
+        const uint64_t claimed = isSteal ? first << 32 | (end - 1u) : (first + 1u) << 32 | end;
+        if (range.compare_exchange_weak(current, claimed, std::memory_order_acq_rel, std::memory_order_acquire)) {
+            index = static_cast<size_t>(isSteal ? end - 1u : first);
+            return true;
+        }
+    }
+}
+
+/**
+ * @brief Changes the priority and affinity of the workers, each one applies it when it wakes up next.
+ * The workers are woken up right away, so the change doesn't wait for the next frame.
+ *
+ * @param scheduling The scheduling of the workers.
+ */
+void RenderPool::setScheduling(const ThreadScheduling& scheduling) {
+    _scheduling.set(scheduling);
+    for (size_t i = 0; i < _workers.size(); i++) {
+        sem_post(&_wakeup);
+    }
+}
+
+/**
+ * @brief Worker thread loop, helps with one frame every time it is woken up.
+ *
+ * @param self The range of the worker.
+ */
+void RenderPool::runWorker(size_t self) {
+    uint32_t schedulingGeneration = 0u;
+    while (true) {
+        if (0 != sem_wait(&_wakeup)) {
+            if (EINTR != errno) LOGE("Render pool worker failed to wait for tasks");
+            continue;
+        }
+        if (_shouldStop.load(std::memory_order_acquire)) break;
+
+        // The frame running when the worker woke up, read before the clock so the wakeup time precedes wokenNs.
+        const uint32_t frameGeneration = _frameGeneration.load(std::memory_order_acquire);
+        const int64_t wakeupNs = _wakeupNs.load(std::memory_order_relaxed);
+        const int64_t wokenNs = WakeupLatency::now();
+        _scheduling.applyIfChanged(schedulingGeneration);
+        // Only a worker that joined the frame was woken up by it, the others found the frame done. A worker woken
+        // by an earlier frame's post can join a frame that started after it woke up, that sample is discarded.
+        if (0u != work(self) && frameGeneration == _frameGeneration.load(std::memory_order_acquire)) {
+            _wakeupLatency.record(wokenNs - wakeupNs);
+        }
+    }
+}
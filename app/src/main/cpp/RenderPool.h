@@ -0,0 +1,91 @@
+#ifndef LEDFX_RENDERPOOL_H
+#define LEDFX_RENDERPOOL_H
+
+#include <semaphore.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "ThreadScheduling.h"
+
+#define RENDER_POOL_MAX_WORKERS 7u  // Enough for the big and middle cores of current phones.
+
+/**
+ * @brief Small work-stealing pool running the independent tasks of one frame in parallel, for example one task
+ * per LED device. run() splits the task indexes into a contiguous range per thread, the calling thread included,
+ * each thread takes tasks from the front of its own range and steals from the back of the others once it is done.
+ * run() returns once every task completed, which makes it the frame barrier.
+ * Neither run() nor the workers allocate, run() must be called from one thread at a time.
+ */
+class RenderPool {
+public:
+    explicit RenderPool(size_t workerCount);
+    RenderPool(const RenderPool&) = delete;
+    RenderPool& operator=(const RenderPool&) = delete;
+    ~RenderPool();
+
+    /**
+     * Runs task(0) to task(taskCount - 1) on the pool and the calling thread, in any order.
+     * A single task runs on the calling thread without waking any worker.
+     *
+     * @param taskCount The number of tasks.
+     * @param task The callable, shared by all threads, it must be safe to call with different indexes concurrently.
+     */
+    template<typename Task>
+    void run(size_t taskCount, Task& task) {
+        runTasks(taskCount, [](void* context, size_t index) { (*static_cast<Task*>(context))(index); }, &task);
+    }
+
+    size_t getWorkerCount() const { return _workers.size(); }
+
+    void setScheduling(const ThreadScheduling& scheduling);
+
+    /**
+     * @return the policy the workers got from the last setScheduling().
+     */
+    ThreadScheduling::Policy getPolicy() const { return _scheduling.getPolicy(); }
+
+    /**
+     * @return the time from run() waking the workers up to each of them running.
+     */
+    const WakeupLatency& getWakeupLatency() const { return _wakeupLatency; }
+
+    /**
+     * @return the number of tasks a thread took from another thread's range since the pool was created.
+     */
+    uint64_t getStealCount() const { return _stealCount.load(std::memory_order_relaxed); }
+
+private:
+    using TaskFunction = void (*)(void* context, size_t index);
+
+    // Remaining task indexes of one thread, the first one in the high half and the end in the low half,
+    // so the owner and the thieves claim tasks with a compare and swap on the same word.
+    struct alignas(64) TaskRange {
+        std::atomic<uint64_t> range{0u};
+    };
+
+    std::vector<TaskRange> _ranges;          // Index 0 is the calling thread, then one per worker.
+    TaskFunction _function = nullptr;        // Written by run() before the ranges are published.
+    void* _context = nullptr;
+    std::atomic<size_t> _remainingTasks{0u};
+    std::atomic<uint64_t> _stealCount{0u};
+    sem_t _wakeup;                           // Posted once per worker needed by the frame.
+    std::mutex _doneLock;
+    std::condition_variable _done;
+    std::atomic<bool> _shouldStop{false};
+    std::atomic<int64_t> _wakeupNs{0};       // When run() last woke the workers up.
+    std::atomic<uint32_t> _frameGeneration{0u};  // Frames that woke workers, bumped after _wakeupNs is written.
+    WakeupLatency _wakeupLatency;
+    SchedulingUpdate _scheduling;  // Applied by the workers when they wake up next.
+    std::vector<std::thread> _workers;
+
+    void runTasks(size_t taskCount, TaskFunction function, void* context);
+    size_t work(size_t self);
+    bool claim(size_t owner, bool isSteal, size_t& index);
+    void runWorker(size_t self);
+};
+
+
+#endif //LEDFX_RENDERPOOL_H
@@ -0,0 +1,65 @@
+#include <cassert>
+#include "SilenceDetector.h"
+
+/**
+ * Constructor for the SilenceDetector class.
+ *
+ * @param sampleRate The sample rate of the audio, used to convert times into frames.
+ * @param enterThreshold Level below which the input starts counting as quiet.
+ * @param exitThreshold Level at or above which a silent input becomes active again, must not be below enterThreshold.
+ * @param holdMs How long the level must stay below enterThreshold before entering silence.
+ * @param keepaliveMs Interval between blank frames while silent, keep it below the device timeout.
+ */
+SilenceDetector::SilenceDetector(int32_t sampleRate, float enterThreshold, float exitThreshold, uint32_t holdMs,
+                                 uint32_t keepaliveMs) :
+        _enterThreshold(enterThreshold), _exitThreshold(exitThreshold),
+        _holdFrames(static_cast<int64_t>(sampleRate) * holdMs / 1000),
+        _keepaliveFrames(static_cast<int64_t>(sampleRate) * keepaliveMs / 1000) {
+    assert(enterThreshold <= exitThreshold && "Exit threshold must not be below the enter threshold");
+}
+
+/**
+ * Advances the state machine by one audio buffer.
+ *
+ * @param level The level of the buffer, between 0.0 and 1.0.
+ * @param numFrames The number of frames in the buffer.
+ * @return The action the engine should take for this buffer.
+ */
+SilenceDetector::Action SilenceDetector::update(float level, int32_t numFrames) {
+    if (_isSilent) {
+        if (level >= _exitThreshold) {
+            // Resume on the very buffer that brought the sound back.
+            _isSilent = false;
+            _quietFrames = 0;
+            return Action::Analyze;
+        }
+        _keepaliveCount += numFrames;
+        if (_keepaliveCount >= _keepaliveFrames) {
+            _keepaliveCount = 0;
+            return Action::SendBlank;
+        }
+        return Action::Idle;
+    }
+
+    if (level >= _enterThreshold) {
+        _quietFrames = 0;
+        return Action::Analyze;
+    }
+
+    _quietFrames += numFrames;
+    if (_quietFrames >= _holdFrames) {
+        _isSilent = true;
+        _keepaliveCount = 0;
+        return Action::SendBlank;
+    }
+    return Action::Analyze;
+}
+
+/**
+ * Returns to the active state, to be called when the audio stream is (re)started.
+ */
+void SilenceDetector::reset() {
+    _isSilent = false;
+    _quietFrames = 0;
+    _keepaliveCount = 0;
+}
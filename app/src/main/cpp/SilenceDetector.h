@@ -0,0 +1,44 @@
+#ifndef LEDFX_SILENCEDETECTOR_H
+#define LEDFX_SILENCEDETECTOR_H
+
+#include <cstdint>
+
+/**
+ * @brief Silence state machine with hysteresis, driven once per audio callback.
+ * The input is considered silent once the level stays below the enter threshold for the hold time,
+ * and it becomes active again as soon as a single buffer reaches the exit threshold.
+ * While silent, the detector only asks for a blank frame on entry and then for periodic keepalives.
+ * All timing is counted in audio frames, so no clock is read on the audio thread.
+ */
+class SilenceDetector {
+public:
+    /**
+     * What the engine should do with the current audio buffer.
+     */
+    enum class Action {
+        Analyze,   // Sound present, run the DSP and send the rendered frame.
+        SendBlank, // Silent, send a blank frame (on entry or as keepalive) without any DSP.
+        Idle       // Silent, skip DSP and network entirely.
+    };
+
+    SilenceDetector(int32_t sampleRate, float enterThreshold, float exitThreshold, uint32_t holdMs, uint32_t keepaliveMs);
+
+    Action update(float level, int32_t numFrames);
+
+    void reset();
+
+    bool isSilent() const { return _isSilent; }
+
+private:
+    const float _enterThreshold;
+    const float _exitThreshold;
+    const int64_t _holdFrames;
+    const int64_t _keepaliveFrames;
+
+    bool _isSilent = false;
+    int64_t _quietFrames = 0;     // Consecutive frames below the enter threshold while active.
+    int64_t _keepaliveCount = 0;  // Frames since the last blank frame while silent.
+};
+
+
+#endif //LEDFX_SILENCEDETECTOR_H
@@ -0,0 +1,83 @@
+#ifndef LEDFX_SNAPSHOTEXCHANGE_H
+#define LEDFX_SNAPSHOTEXCHANGE_H
+
+#include <atomic>
+#include <utility>
+
+/**
+ * @brief Hands immutable snapshots from any number of publishing threads to a single consuming thread, lock free.
+ * Publishers build a snapshot, allocate it and swap it into a pending slot, a snapshot that was never picked up
+ * is deleted right away. The consumer swaps the pending slot out, so it never waits and never allocates or frees:
+ * the snapshot it replaces is pushed on a retired list and deleted by the next publish(), or by the destructor.
+ * The consumer is whichever thread owns the output at the time, acquire() and get() must not be called
+ * from two threads concurrently.
+ */
+template<typename T>
+class SnapshotExchange {
+public:
+    SnapshotExchange() = default;
+    SnapshotExchange(const SnapshotExchange&) = delete;
+    SnapshotExchange& operator=(const SnapshotExchange&) = delete;
+
+    ~SnapshotExchange() {
+        delete _pending.exchange(nullptr, std::memory_order_acquire);
+        deleteList(_retired.exchange(nullptr, std::memory_order_acquire));
+        delete _current;
+    }
+
+    /**
+     * Publishes a new snapshot, the consumer picks it up on its next acquire(). Also frees the retired snapshots.
+     *
+     * @param value The snapshot, moved into a heap node on the calling thread.
+     */
+    void publish(T value) {
+        Node* node = new Node{std::move(value), nullptr};
+        delete _pending.exchange(node, std::memory_order_acq_rel);
+        deleteList(_retired.exchange(nullptr, std::memory_order_acquire));
+    }
+
+    /**
+     * Adopts the latest published snapshot, consumer only.
+     *
+     * @return the newly adopted snapshot, nullptr if nothing was published since the previous call.
+     * It stays valid, and owned by the consumer, until a later acquire() adopts another one.
+     */
+    T* acquire() {
+        Node* node = _pending.exchange(nullptr, std::memory_order_acquire);
+        if (!node) return nullptr;
+
+        if (_current) {
+            _current->next = _retired.load(std::memory_order_relaxed);
+            while (!_retired.compare_exchange_weak(_current->next, _current, std::memory_order_release,
+                                                   std::memory_order_relaxed)) {}
+        }
+        _current = node;
+        return &node->value;
+    }
+
+    /**
+     * @return the snapshot adopted by the last successful acquire(), nullptr before the first one. Consumer only.
+     */
+    const T* get() const { return _current ? &_current->value : nullptr; }
+
+private:
+    struct Node {
+        T value;
+        Node* next;
+    };
+
+    std::atomic<Node*> _pending{nullptr};
+    std::atomic<Node*> _retired{nullptr};  // Replaced snapshots, linked through next, freed by publishers.
+    Node* _current = nullptr;              // Consumer side only.
+
+    static void deleteList(Node* node) {
+        while (node) {
+            Node* next = node->next;
+            delete node;
+            node = next;
+        }
+    }
+};
+
+
+#endif //LEDFX_SNAPSHOTEXCHANGE_H
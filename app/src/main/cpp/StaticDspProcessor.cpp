@@ -0,0 +1,37 @@
+#include "logging_macros.h"
+#include "AudioPipeline.h"
+#include "StaticDspProcessor.h"
+
+// Presets compiled in: the default analysis at the common device sample rates. Every preset costs its tables
+// in the binary, only add the ones the app can select.
+template class StaticDspProcessor<FFT_SIZE, HOP_SIZE, FILTER_SIZE, 44100u, MIN_FREQ_HZ, MAX_FREQ_HZ>;
+template class StaticDspProcessor<FFT_SIZE, HOP_SIZE, FILTER_SIZE, 48000u, MIN_FREQ_HZ, MAX_FREQ_HZ>;
+
+/**
+ * Picks the compile time specialized processor matching a runtime configuration.
+ *
+ * @param winS The window size for the FFT.
+ * @param hopS The hop size.
+ * @param filterS The number of filters in the Mel filter bank.
+ * @param sampleRate The sample rate of the audio.
+ * @param fMin The minimum frequency for the Mel filter bank.
+ * @param fMax The maximum frequency for the Mel filter bank.
+ * @param channelCount The number of interleaved channels in the audio data, 1 or 2.
+ * @return The specialized processor, nullptr if no preset matches, the caller then falls back to AubioDspProcessor.
+ */
+std::unique_ptr<IDspProcessor> makeStaticDspProcessor(size_t winS, size_t hopS, size_t filterS, float sampleRate,
+                                                      float fMin, float fMax, size_t channelCount) {
+    if (HOP_SIZE != hopS || FILTER_SIZE != filterS || MIN_FREQ_HZ != fMin || MAX_FREQ_HZ != fMax) return nullptr;
+
+    std::unique_ptr<IDspProcessor> processor;
+    if (FFT_SIZE == winS && 44100.0f == sampleRate) {
+        processor = std::make_unique<StaticDspProcessor<FFT_SIZE, HOP_SIZE, FILTER_SIZE, 44100u, MIN_FREQ_HZ, MAX_FREQ_HZ>>(channelCount);
+    } else if (FFT_SIZE == winS && 48000.0f == sampleRate) {
+        processor = std::make_unique<StaticDspProcessor<FFT_SIZE, HOP_SIZE, FILTER_SIZE, 48000u, MIN_FREQ_HZ, MAX_FREQ_HZ>>(channelCount);
+    }
+    if (processor) {
+        LOGI("StaticDspProcessor selected for window size: %zu, hop size: %zu, filter size: %zu, sample rate: %.2f",
+             winS, hopS, filterS, sampleRate);
+    }
+    return processor;
+}
@@ -0,0 +1,494 @@
+#ifndef LEDFX_STATICDSPPROCESSOR_H
+#define LEDFX_STATICDSPPROCESSOR_H
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include "ConstexprMath.h"
+#include "IDspProcessor.h"
+#include "OnsetBeatTracker.h"
+
+/**
+ * Triangular Mel filter bank with its non zero range per band, generated at compile time.
+ */
+template<size_t Bins, size_t Bands>
+struct StaticMelTable {
+    std::array<std::array<float, Bins>, Bands> coeffs{};
+    std::array<uint32_t, Bands> first{};  // First non zero bin of each band.
+    std::array<uint32_t, Bands> last{};   // One past the last non zero bin of each band.
+};
+
+/**
+ * Hz to Mel conversion of the HTK formula, used by aubio_filterbank_set_mel_coeffs.
+ */
+constexpr double staticHzToMel(const double hz) {
+    return 2595.0 * constexprLog(1.0 + hz / 700.0) / constexprLog(10.0);
+}
+
+constexpr double staticMelToHz(const double mel) {
+    return 700.0 * (constexprPow(10.0, mel / 2595.0) - 1.0);
+}
+
+/**
+ * Builds the same filter bank as aubio_filterbank_set_mel_coeffs with a norm of 1,
+ * triangles of unit area between Mel spaced frequencies, sampled at the FFT bin frequencies.
+ */
+template<size_t WinS, size_t Bands>
+constexpr StaticMelTable<WinS / 2u + 1u, Bands> makeStaticMelTable(const double sampleRate, const double fMin, const double fMax) {
+    constexpr size_t Bins = WinS / 2u + 1u;
+    StaticMelTable<Bins, Bands> table{};
+
+    std::array<double, Bands + 2u> freqs{};
+    const double start = staticHzToMel(fMin);
+    const double step = (staticHzToMel(fMax) - start) / static_cast<double>(Bands + 1u);
+    for (size_t m = 0; m < Bands + 2u; m++) {
+        freqs[m] = std::min(staticMelToHz(start + step * static_cast<double>(m)), sampleRate / 2.0);
+    }
+
+    std::array<double, Bins> binFreqs{};
+    for (size_t bin = 0; bin < Bins; bin++) {
+        binFreqs[bin] = static_cast<double>(bin) * sampleRate / static_cast<double>(WinS);
+    }
+
+    for (size_t band = 0; band < Bands; band++) {
+        const double lower = freqs[band];
+        const double center = freqs[band + 1u];
+        const double upper = freqs[band + 2u];
+        const double height = 2.0 / (upper - lower);
+        std::array<float, Bins>& row = table.coeffs[band];
+
+        size_t bin = 0;
+        for (; bin < Bins - 1u; bin++) {
+            if (binFreqs[bin] <= lower && binFreqs[bin + 1u] > lower) {
+                bin++;
+                break;
+            }
+        }
+        const double riseInc = height / (center - lower);
+        for (; bin < Bins - 1u; bin++) {
+            row[bin] = static_cast<float>((binFreqs[bin] - lower) * riseInc);
+            if (binFreqs[bin + 1u] >= center) {
+                bin++;
+                break;
+            }
+        }
+        const double downInc = height / (upper - center);
+        for (; bin < Bins - 1u; bin++) {
+            row[bin] = std::max(0.0f, static_cast<float>(row[bin] + (upper - binFreqs[bin]) * downInc));
+            if (binFreqs[bin + 1u] >= upper) break;
+        }
+
+        uint32_t first = 0u;
+        while (first < Bins && row[first] <= 0.0f) first++;
+        uint32_t last = Bins;
+        while (last > first && row[last - 1u] <= 0.0f) last--;
+        table.first[band] = first;
+        table.last[band] = last;
+    }
+    return table;
+}
+
+/**
+ * Hann window, same definition as aubio's "hanning" window.
+ */
+template<size_t WinS>
+constexpr std::array<float, WinS> makeStaticWindow() {
+    std::array<float, WinS> window{};
+    for (size_t i = 0; i < WinS; i++) {
+        window[i] = static_cast<float>(0.5 - 0.5 * constexprCos(2.0 * CONSTEXPR_PI * static_cast<double>(i) / WinS));
+    }
+    return window;
+}
+
+template<size_t FftS>
+constexpr std::array<uint32_t, FftS> makeStaticBitReverse() {
+    std::array<uint32_t, FftS> table{};
+    uint32_t bits = 0u;
+    while ((1u << bits) < FftS) bits++;
+    for (uint32_t i = 0; i < FftS; i++) {
+        uint32_t reversed = 0u;
+        for (uint32_t b = 0; b < bits; b++) {
+            reversed |= ((i >> b) & 1u) << (bits - 1u - b);
+        }
+        table[i] = reversed;
+    }
+    return table;
+}
+
+/**
+ * Cosines and sines of every radix-2 stage stored contiguously, W = exp(-2*pi*i*j / (2 * half)) for j < half.
+ */
+template<size_t FftS>
+constexpr std::array<std::array<float, FftS>, 2> makeStaticStageTwiddles() {
+    std::array<std::array<float, FftS>, 2> twiddles{};
+    size_t offset = 0u;
+    for (size_t half = 1u; half < FftS; half <<= 1u) {
+        for (size_t j = 0; j < half; j++) {
+            const double angle = -CONSTEXPR_PI * static_cast<double>(j) / static_cast<double>(half);
+            twiddles[0][offset + j] = static_cast<float>(constexprCos(angle));
+            twiddles[1][offset + j] = static_cast<float>(constexprSin(angle));
+        }
+        offset += half;
+    }
+    return twiddles;
+}
+
+/**
+ * Cosines and sines of the split step recovering the WinS real FFT from the WinS / 2 complex one.
+ */
+template<size_t WinS>
+constexpr std::array<std::array<float, WinS / 2u + 1u>, 2> makeStaticSplitTwiddles() {
+    std::array<std::array<float, WinS / 2u + 1u>, 2> twiddles{};
+    for (size_t k = 0; k < WinS / 2u + 1u; k++) {
+        const double angle = -2.0 * CONSTEXPR_PI * static_cast<double>(k) / static_cast<double>(WinS);
+        twiddles[0][k] = static_cast<float>(constexprCos(angle));
+        twiddles[1][k] = static_cast<float>(constexprSin(angle));
+    }
+    return twiddles;
+}
+
+/**
+ * @brief Float DSP processor specialized at compile time for one analysis configuration.
+ * Same analysis as AubioDspProcessor (pre-emphasis biquad, Hann window, FFT magnitudes, Mel filter bank
+ * raised to the 4th power, spectral flux), but every buffer is a std::array and the window, FFT twiddles
+ * and Mel filter banks are constexpr tables. Each band is projected over its constant bin range by its own
+ * instantiation, so the band loop is unrolled and its inner loops have a fixed trip count.
+ * The common presets are instantiated in StaticDspProcessor.cpp, see makeStaticDspProcessor().
+ */
+template<size_t WinS, size_t HopS, size_t Bands, uint32_t SampleRate, uint32_t MinFreqHz, uint32_t MaxFreqHz>
+class StaticDspProcessor : public IDspProcessor {
+    static_assert(0u == (WinS & (WinS - 1u)) && WinS >= 8u, "Window size must be a power of two");
+    static_assert(HopS <= WinS, "Hop size must not exceed the window size");
+    static_assert(Bands >= 2u, "At least two Mel bands are needed");
+
+    static constexpr size_t Bins = WinS / 2u + 1u;
+    static constexpr size_t FftS = WinS / 2u;      // Size of the complex FFT packing the real input.
+    static constexpr size_t HalfBands = Bands / 2u;
+
+    using MelTable = StaticMelTable<Bins, Bands>;
+    using HalfMelTable = StaticMelTable<Bins, HalfBands>;
+
+    static constexpr MelTable kMel = makeStaticMelTable<WinS, Bands>(SampleRate, MinFreqHz, MaxFreqHz);
+    static constexpr HalfMelTable kHalfMel = makeStaticMelTable<WinS, HalfBands>(SampleRate, MinFreqHz, MaxFreqHz);
+
+    static constexpr std::array<float, WinS> kWindow = makeStaticWindow<WinS>();
+    static constexpr std::array<uint32_t, FftS> kBitReverse = makeStaticBitReverse<FftS>();
+    static constexpr std::array<std::array<float, FftS>, 2> kStageTwiddles = makeStaticStageTwiddles<FftS>();
+    static constexpr std::array<std::array<float, Bins>, 2> kSplitTwiddles = makeStaticSplitTwiddles<WinS>();
+
+    /**
+     * Pre-emphasis biquad, Direct Form I in double like aubio_filter_do.
+     */
+    struct PreEmphasis {
+        double x1 = 0.0, x2 = 0.0, y1 = 0.0, y2 = 0.0;
+
+        void process(std::array<float, HopS>& hop) {
+            for (float& sample : hop) {
+                const double x = sample;
+                const double y = 1.00000285 * x - 1.93078064 * x1 + 0.95054174 * x2 + 1.93078064 * y1 - 0.95054459 * y2;
+                x2 = x1;
+                x1 = x;
+                y2 = y1;
+                y1 = y;
+                sample = static_cast<float>(y);
+            }
+        }
+    };
+
+    /**
+     * Complex spectrum of one channel, Bins bins of the real FFT.
+     */
+    struct Spectrum {
+        std::array<float, Bins> re;
+        std::array<float, Bins> im;
+    };
+
+    const size_t _channelCount;
+    size_t _hopFill = 0u;        // Frames already collected for the next mono hop.
+    size_t _stereoHopFill = 0u;  // Same, for the next stereo hop.
+    uint32_t _hopDecimation = 1u;
+    uint32_t _hopCounter = 0u;
+    uint64_t _analyzedHopCount = 0u;  // Hops whose spectrum was computed.
+    bool _reducedBands = false;
+
+    PreEmphasis _preEmphasis;
+    PreEmphasis _preEmphasisRight;
+    std::array<float, HopS> _hop{};        // Mono hop being collected.
+    std::array<float, HopS> _hopLeft{};
+    std::array<float, HopS> _hopRight{};
+    std::array<float, WinS> _frame{};      // Mono or left sliding analysis window.
+    std::array<float, WinS> _frameRight{};
+    std::array<float, FftS> _re{};         // Complex FFT buffers.
+    std::array<float, FftS> _im{};
+    Spectrum _spectrum{};                  // Mono or left spectrum.
+    Spectrum _spectrumRight{};
+    std::array<float, Bins> _power{};      // Squared magnitudes, projected on the Mel filter bank.
+    std::array<float, Bins> _magnitude{};
+    std::array<float, Bins> _lastMagnitude{};
+    std::array<float, Bands> _melOutput{};
+    std::array<float, Bands> _melLeft{};
+    std::array<float, Bands> _melRight{};
+    std::array<float, HalfBands> _melReduced{};
+
+    OnsetBeatTracker _onsetBeatTracker;
+    AudioFeatures _features;
+
+    std::shared_ptr<LogSpectrum> _logSpectrum;  // Optional, computed from the mono or mid _power.
+    std::shared_ptr<ExpFilter> _logLevels;
+
+    static void slideWindow(std::array<float, WinS>& frame, const std::array<float, HopS>& hop) {
+        std::copy(frame.begin() + HopS, frame.end(), frame.begin());
+        std::copy(hop.begin(), hop.end(), frame.end() - HopS);
+    }
+
+    bool isAnalysisHop() {
+        const bool isDue = 0u == _hopCounter;
+        _hopCounter = (_hopCounter + 1u) % _hopDecimation;
+        if (isDue) _analyzedHopCount++;
+        return isDue;
+    }
+
+    /**
+     * Windows a frame and computes its real FFT. The WinS real samples are packed as WinS / 2 complex ones
+     * (even samples in the real part, odd ones in the imaginary part), transformed with a radix-2 FFT,
+     * then split back into the Bins bins of the real FFT.
+     */
+    void computeSpectrum(const std::array<float, WinS>& frame, Spectrum& spectrum) {
+        for (size_t n = 0; n < FftS; n++) {
+            const uint32_t r = kBitReverse[n];
+            _re[r] = frame[2u * n] * kWindow[2u * n];
+            _im[r] = frame[2u * n + 1u] * kWindow[2u * n + 1u];
+        }
+
+        size_t offset = 0u;
+        for (size_t half = 1u; half < FftS; half <<= 1u) {
+            const float* wr = kStageTwiddles[0].data() + offset;
+            const float* wi = kStageTwiddles[1].data() + offset;
+            for (size_t start = 0; start < FftS; start += 2u * half) {
+                for (size_t j = 0; j < half; j++) {
+                    const size_t a = start + j;
+                    const size_t b = a + half;
+                    const float tr = _re[b] * wr[j] - _im[b] * wi[j];
+                    const float ti = _re[b] * wi[j] + _im[b] * wr[j];
+                    _re[b] = _re[a] - tr;
+                    _im[b] = _im[a] - ti;
+                    _re[a] += tr;
+                    _im[a] += ti;
+                }
+            }
+            offset += half;
+        }
+
+        // X[k] = (Z[k] + conj(Z[M - k])) / 2 - i * W^k * (Z[k] - conj(Z[M - k])) / 2
+        for (size_t k = 0; k < Bins; k++) {
+            const size_t a = k % FftS;
+            const size_t b = (FftS - k) % FftS;
+            const float evenRe = _re[a] + _re[b];
+            const float evenIm = _im[a] - _im[b];
+            const float oddRe = _im[a] + _im[b];
+            const float oddIm = _re[b] - _re[a];
+            const float wr = kSplitTwiddles[0][k];
+            const float wi = kSplitTwiddles[1][k];
+            spectrum.re[k] = 0.5f * (evenRe + oddRe * wr - oddIm * wi);
+            spectrum.im[k] = 0.5f * (evenIm + oddRe * wi + oddIm * wr);
+        }
+    }
+
+    void computePower(const Spectrum& spectrum) {
+        for (size_t k = 0; k < Bins; k++) {
+            _power[k] = spectrum.re[k] * spectrum.re[k] + spectrum.im[k] * spectrum.im[k];
+        }
+    }
+
+    /**
+     * Projects the squared power (the magnitude to the 4th power, like the aubio filter bank) on band J.
+     */
+    template<const auto& Table, size_t J>
+    float projectBand() const {
+        float acc = 0.0f;
+        for (size_t k = Table.first[J]; k < Table.last[J]; k++) {
+            acc += Table.coeffs[J][k] * (_power[k] * _power[k]);
+        }
+        return acc;
+    }
+
+    template<const auto& Table, size_t N, size_t... J>
+    void projectBands(std::array<float, N>& mel, std::index_sequence<J...>) const {
+        ((mel[J] = projectBand<Table, J>()), ...);
+    }
+
+    /**
+     * Projects _power on the Mel filter bank. With reduced bands, the half-size filter bank is used
+     * and each of its bands is repeated twice, so the output always has the full band count.
+     */
+    void projectMel(std::array<float, Bands>& mel) {
+        if (!_reducedBands) {
+            projectBands<kMel>(mel, std::make_index_sequence<Bands>());
+            return;
+        }
+        projectBands<kHalfMel>(_melReduced, std::make_index_sequence<HalfBands>());
+        for (size_t i = 0; i < Bands; i++) {
+            mel[i] = _melReduced[std::min(i / 2u, HalfBands - 1u)];
+        }
+    }
+
+    /**
+     * Computes the spectral flux of a spectrum, then picks onsets and tracks beats from it.
+     */
+    void detectFeatures(const Spectrum& spectrum) {
+        float flux = 0.0f;
+        for (size_t k = 0; k < Bins; k++) {
+            _magnitude[k] = std::sqrt(spectrum.re[k] * spectrum.re[k] + spectrum.im[k] * spectrum.im[k]);
+            if (_magnitude[k] > _lastMagnitude[k]) flux += _magnitude[k] - _lastMagnitude[k];
+        }
+        _lastMagnitude = _magnitude;
+        _onsetBeatTracker.process(flux, _features);
+    }
+
+    void analyzeMono(const std::shared_ptr<ExpFilter>& melBank) {
+        _preEmphasis.process(_hop);
+        slideWindow(_frame, _hop);
+        if (!isAnalysisHop()) {
+            // Hold the last detection value so the beat tracker keeps its timing.
+            _onsetBeatTracker.hold(_features);
+            return;
+        }
+
+        computeSpectrum(_frame, _spectrum);
+        detectFeatures(_spectrum);
+        computePower(_spectrum);
+        projectMel(_melOutput);
+        melBank->update(_melOutput.data(), Bands);
+        if (_logSpectrum) _logSpectrum->process(_power.data(), *_logLevels);
+    }
+
+    void analyzeStereo(const std::shared_ptr<ExpFilter>& melBank, const std::shared_ptr<ExpFilter>& leftMelBank,
+                       const std::shared_ptr<ExpFilter>& rightMelBank) {
+        _preEmphasis.process(_hopLeft);
+        _preEmphasisRight.process(_hopRight);
+        slideWindow(_frame, _hopLeft);
+        slideWindow(_frameRight, _hopRight);
+        if (!isAnalysisHop()) {
+            _onsetBeatTracker.hold(_features);
+            return;
+        }
+
+        computeSpectrum(_frame, _spectrum);
+        computeSpectrum(_frameRight, _spectrumRight);
+        computePower(_spectrum);
+        projectMel(_melLeft);
+        computePower(_spectrumRight);
+        projectMel(_melRight);
+        for (size_t i = 0; i < Bands; i++) {
+            _melOutput[i] = 0.5f * (_melLeft[i] + _melRight[i]);
+        }
+        leftMelBank->update(_melLeft.data(), Bands);
+        rightMelBank->update(_melRight.data(), Bands);
+        melBank->update(_melOutput.data(), Bands);
+
+        // The mid spectrum, the average of both complex spectra, drives the onset and beat features.
+        for (size_t k = 0; k < Bins; k++) {
+            _spectrum.re[k] = 0.5f * (_spectrum.re[k] + _spectrumRight.re[k]);
+            _spectrum.im[k] = 0.5f * (_spectrum.im[k] + _spectrumRight.im[k]);
+        }
+        detectFeatures(_spectrum);
+        if (_logSpectrum) {
+            computePower(_spectrum);
+            _logSpectrum->process(_power.data(), *_logLevels);
+        }
+    }
+
+public:
+    explicit StaticDspProcessor(const size_t channelCount) :
+            _channelCount(channelCount), _onsetBeatTracker(HopS, static_cast<float>(SampleRate)) {
+        assert((1u == channelCount || 2u == channelCount) && "Only mono and stereo input is supported.");
+    }
+
+    /**
+     * Down-mixes the interleaved float input to mono, collects it into hops and analyses every complete hop.
+     */
+    void doMelBank(void* audioData, const size_t numFrames, std::shared_ptr<ExpFilter> melBank) override {
+        const auto* in = static_cast<const float*>(audioData);
+        _features.isOnset = false;
+        _features.isBeat = false;
+
+        size_t done = 0u;
+        while (done < numFrames) {
+            const size_t count = std::min(numFrames - done, HopS - _hopFill);
+            if (2u == _channelCount) {
+                for (size_t i = 0; i < count; i++) {
+                    _hop[_hopFill + i] = 0.5f * (in[2u * (done + i)] + in[2u * (done + i) + 1u]);
+                }
+            } else {
+                std::copy(in + done, in + done + count, _hop.begin() + _hopFill);
+            }
+            _hopFill += count;
+            done += count;
+
+            if (HopS == _hopFill) {
+                analyzeMono(melBank);
+                _hopFill = 0u;
+            }
+        }
+    }
+
+    /**
+     * Analyses both channels of the interleaved float input, falls back to the mirrored mono analysis on mono input.
+     */
+    void doStereoMelBank(void* audioData, const size_t numFrames, std::shared_ptr<ExpFilter> melBank,
+                         std::shared_ptr<ExpFilter> leftMelBank, std::shared_ptr<ExpFilter> rightMelBank) override {
+        if (2u != _channelCount) {
+            doMelBank(audioData, numFrames, melBank);
+            leftMelBank->valueVec = melBank->valueVec;
+            rightMelBank->valueVec = melBank->valueVec;
+            return;
+        }
+
+        const auto* in = static_cast<const float*>(audioData);
+        _features.isOnset = false;
+        _features.isBeat = false;
+
+        size_t done = 0u;
+        while (done < numFrames) {
+            const size_t count = std::min(numFrames - done, HopS - _stereoHopFill);
+            for (size_t i = 0; i < count; i++) {
+                _hopLeft[_stereoHopFill + i] = in[2u * (done + i)];
+                _hopRight[_stereoHopFill + i] = in[2u * (done + i) + 1u];
+            }
+            _stereoHopFill += count;
+            done += count;
+
+            if (HopS == _stereoHopFill) {
+                analyzeStereo(melBank, leftMelBank, rightMelBank);
+                _stereoHopFill = 0u;
+            }
+        }
+    }
+
+    const AudioFeatures& getFeatures() const override { return _features; }
+
+    uint64_t getAnalyzedHopCount() const override { return _analyzedHopCount; }
+
+    void setHopDecimation(const uint32_t decimation) override {
+        _hopDecimation = std::max<uint32_t>(decimation, 1u);
+        _hopCounter = 0u;
+    }
+
+    void setReducedBands(const bool isReduced) override { _reducedBands = isReduced; }
+
+    void setLogSpectrum(std::shared_ptr<LogSpectrum> logSpectrum, std::shared_ptr<ExpFilter> levels) override {
+        assert((!logSpectrum || Bins == logSpectrum->getBinCount()) && "Log spectrum built for another FFT size");
+        _logSpectrum = std::move(logSpectrum);
+        _logLevels = std::move(levels);
+    }
+};
+
+std::unique_ptr<IDspProcessor> makeStaticDspProcessor(size_t winS, size_t hopS, size_t filterS, float sampleRate,
+                                                      float fMin, float fMax, size_t channelCount);
+
+
+#endif //LEDFX_STATICDSPPROCESSOR_H
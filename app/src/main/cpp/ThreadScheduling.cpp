@@ -0,0 +1,99 @@
+#include <logging_macros.h>
+
+#include "ThreadScheduling.h"
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstdio>
+
+#define MAX_CPUS 64u  // CPUs addressable by the mask.
+
+/**
+ * @brief Applies the affinity and the priority to the calling thread, a default configuration restores the
+ * normal policy at nice 0.
+ *
+ * @return The policy the thread runs with, Fifo only if SCHED_FIFO was allowed.
+ */
+ThreadScheduling::Policy ThreadScheduling::apply() const {
+    // Linux affinity and nice levels are per thread, the calling thread is addressed by its thread ID.
+    const pid_t tid = static_cast<pid_t>(syscall(SYS_gettid));
+
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (size_t cpu = 0; cpu < MAX_CPUS && cpu < CPU_SETSIZE; cpu++) {
+        if (0u == cpuMask || (cpuMask >> cpu & 1u)) CPU_SET(cpu, &cpus);
+    }
+    if (0 != sched_setaffinity(tid, sizeof(cpus), &cpus)) {
+        LOGW("Failed to set the CPU affinity of thread %d to 0x%llx", tid, static_cast<unsigned long long>(cpuMask));
+    }
+
+    if (0 < fifoPriority) {
+        sched_param param{};
+        param.sched_priority = fifoPriority;
+        if (0 == pthread_setschedparam(pthread_self(), SCHED_FIFO, &param)) return Policy::Fifo;
+    }
+
+    sched_param param{};
+    param.sched_priority = 0;
+    pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+    if (0 != setpriority(PRIO_PROCESS, static_cast<id_t>(tid), niceLevel)) {
+        if (0 != niceLevel) LOGW("Failed to set the nice level of thread %d to %d", tid, niceLevel);
+        return Policy::Default;
+    }
+    return 0 != niceLevel ? Policy::Nice : Policy::Default;
+}
+
+/**
+ * @brief Finds the big cores of a big.LITTLE SoC from the maximum frequency of each core.
+ *
+ * @return The mask of the CPUs faster than the slowest cluster, 0 if all cores are alike or the frequencies
+ * are unknown.
+ */
+uint64_t ThreadScheduling::getBigCoreMask() {
+    long maxKhz[MAX_CPUS] = {};
+    long slowestKhz = 0;
+    for (size_t cpu = 0; cpu < MAX_CPUS; cpu++) {
+        char path[80];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%zu/cpufreq/cpuinfo_max_freq", cpu);
+        FILE* file = fopen(path, "r");
+        if (!file) continue;
+        if (1 == fscanf(file, "%ld", &maxKhz[cpu]) && 0 < maxKhz[cpu]) {
+            if (0 == slowestKhz || maxKhz[cpu] < slowestKhz) slowestKhz = maxKhz[cpu];
+        }
+        fclose(file);
+    }
+
+    uint64_t mask = 0u;
+    for (size_t cpu = 0; cpu < MAX_CPUS; cpu++) {
+        if (maxKhz[cpu] > slowestKhz) mask |= uint64_t(1) << cpu;
+    }
+    return mask;
+}
+
+/**
+ * @brief Changes the scheduling, owner side. The threads apply it when they wake up next, see applyIfChanged().
+ *
+ * @param scheduling The new scheduling.
+ */
+void SchedulingUpdate::set(const ThreadScheduling& scheduling) {
+    std::lock_guard<std::mutex> lock(_lock);
+    _scheduling = scheduling;
+    _generation.fetch_add(1u, std::memory_order_release);
+}
+
+/**
+ * @brief Applies the scheduling to the calling thread if it changed since the thread last applied it.
+ *
+ * @param generation The generation the thread applied last, 0 before the first one, updated.
+ * @return The policy the scheduling got last.
+ */
+ThreadScheduling::Policy SchedulingUpdate::applyIfChanged(uint32_t& generation) {
+    if (generation != _generation.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(_lock);
+        generation = _generation.load(std::memory_order_relaxed);
+        _policy.store(_scheduling.apply(), std::memory_order_relaxed);
+    }
+    return _policy.load(std::memory_order_relaxed);
+}
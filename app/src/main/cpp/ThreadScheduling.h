@@ -0,0 +1,89 @@
+#ifndef LEDFX_THREADSCHEDULING_H
+#define LEDFX_THREADSCHEDULING_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+#define WORKER_FIFO_PRIORITY 2     // Low SCHED_FIFO priority, above every normal thread and below the audio HAL.
+#define WORKER_NICE_LEVEL (-16)    // Android's audio thread priority, used when SCHED_FIFO is not allowed.
+
+/**
+ * @brief Priority and CPU affinity of a worker thread, applied by the thread itself.
+ * SCHED_FIFO is tried first, when the system doesn't allow it (no CAP_SYS_NICE or RLIMIT_RTPRIO, which is the
+ * case for regular Android apps) the thread stays in the normal policy with the nice level instead.
+ * Only uses Linux calls, so the app and the host tools behave the same.
+ */
+struct ThreadScheduling {
+    enum class Policy : uint8_t {
+        Default,  // Normal policy at nice 0, nothing else was requested or allowed.
+        Nice,     // Normal policy at niceLevel.
+        Fifo      // SCHED_FIFO at fifoPriority.
+    };
+
+    int fifoPriority = 0;   // SCHED_FIFO priority tried first, 1 to 99, 0 to skip it.
+    int niceLevel = 0;      // Nice level of the normal policy, -20 to 19.
+    uint64_t cpuMask = 0u;  // Bit i allows CPU i, 0 for any CPU.
+
+    Policy apply() const;
+
+    static uint64_t getBigCoreMask();
+};
+
+/**
+ * @brief A ThreadScheduling changed by its owner and applied by the threads it is meant for, each one by itself
+ * when it wakes up next. The threads only take the lock after a change.
+ */
+class SchedulingUpdate {
+public:
+    void set(const ThreadScheduling& scheduling);
+    ThreadScheduling::Policy applyIfChanged(uint32_t& generation);
+
+    /**
+     * @return the policy the last thread applying the scheduling got.
+     */
+    ThreadScheduling::Policy getPolicy() const { return _policy.load(std::memory_order_relaxed); }
+
+private:
+    std::mutex _lock;  // Guards _scheduling.
+    ThreadScheduling _scheduling;
+    std::atomic<uint32_t> _generation{0u};
+    std::atomic<ThreadScheduling::Policy> _policy{ThreadScheduling::Policy::Default};
+};
+
+/**
+ * @brief Time from waking a thread up to the thread running, recorded by the woken thread.
+ */
+class WakeupLatency {
+public:
+    /**
+     * @return the steady clock in ns, read by the waking thread before waking and by the woken one after.
+     */
+    static int64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void record(int64_t latencyNs) {
+        _count.fetch_add(1u, std::memory_order_relaxed);
+        _totalNs.fetch_add(latencyNs, std::memory_order_relaxed);
+        int64_t maxNs = _maxNs.load(std::memory_order_relaxed);
+        while (latencyNs > maxNs && !_maxNs.compare_exchange_weak(maxNs, latencyNs, std::memory_order_relaxed)) {}
+    }
+
+    int64_t getMeanNs() const {
+        const uint64_t count = _count.load(std::memory_order_relaxed);
+        return count ? _totalNs.load(std::memory_order_relaxed) / static_cast<int64_t>(count) : 0;
+    }
+
+    int64_t getMaxNs() const { return _maxNs.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> _count{0u};
+    std::atomic<int64_t> _totalNs{0};
+    std::atomic<int64_t> _maxNs{0};
+};
+
+
+#endif //LEDFX_THREADSCHEDULING_H
@@ -6,42 +6,110 @@
 
 #include "WLedDevice.h"
 #include "cassert"
+#include <algorithm>
+#include <cerrno>
+#include <sys/uio.h>
 
 /**
- * @brief Constructor to initialize the WLedDevice class, setting up the socket address structure (_addr).
- * Initializes the address family (IPv4) for the device.
- * This method is called when an object of WLedDevice is created.
+ * @brief Constructor to initialize the WLedDevice class.
+ * The device has no configuration until updateConfig() is called.
  */
 WLedDevice::WLedDevice(){
-    _addr.sin_family = AF_INET;
 }
 
 /**
  * @brief Updates the configuration for the WLedDevice with the specified IP address, port number, and LED count.
- * This function configures the device for communication by setting up its IP, port, and the number of LEDs it will control.
+ * The configuration is built on the calling thread and published as an immutable snapshot, the flushing thread
+ * switches to it before its next frame. It can be called at any time, also while frames are being sent.
  *
  * @param iPaddr The IP address of the WLed device, formatted as a string (IPv4).
  * @param portNum The port number on which the device listens.
- * @param numLeds The number of LEDs that this device will control (should be between 1 and 490).
+ * @param numLeds The number of LEDs that this device will control (at least 1, at most 490 with DRGB).
  *
  * @throws std::assertion Throws an assertion error if:
- *          - The number of LEDs is not within the range (1 to 490).
+ *          - The number of LEDs is 0.
  *          - The IP address exceeds the maximum allowed length (15 characters).
  */
 void WLedDevice::updateConfig(std::string iPaddr, uint16_t portNum, size_t numLeds) {
-    // Ensure the number of LEDs is between 1 and 490 (valid range)
-    assert((((1 > numLeds) && (490 > numLeds)) == true ) && "Invalid LED count. LED count must be between 1 and 490.");
+    // Ensure there is at least one LED, DRGB additionally limits the count to WLED_DRGB_MAX_LEDS when flushing
+    assert(0 < numLeds && "Invalid LED count. LED count must be at least 1.");
     // Ensure the IP address is valid (max length of 15 characters for IPv4)
     assert(16 > iPaddr.size() && "Invalid IP Address. The address exceeds max length of 15 characters.");
 
-    _addr.sin_port = htons(portNum); // Port number
-    _addr.sin_addr.s_addr = inet_addr(iPaddr.c_str()); // IP address
+    Config config{};
+    config.addr.sin_family = AF_INET;
+    config.addr.sin_port = htons(portNum); // Port number
+    config.addr.sin_addr.s_addr = inet_addr(iPaddr.c_str()); // IP address
+    config.numLeds = numLeds;
+    _config.publish(std::move(config));
+}
+
+/**
+ * @brief Switches to the latest published configuration, if any, reconnecting an open socket to its address.
+ * Must be called from the thread that flushes, once per frame, and the returned configuration passed to
+ * encode() or flush(), so a frame is checked and split against one configuration only. Lock free, it only
+ * allocates when a new configuration has more LEDs than any before, see reservePackets().
+ *
+ * @return The configuration of this frame, nullptr if none was ever published.
+ */
+const WLedDevice::Config* WLedDevice::acquireConfig() {
+    if (const Config* config = _config.acquire()) {
+        reservePackets(config->numLeds);
+        if (0 <= _sckt) connectSocket();
+    }
+    return _config.get();
+}
+
+/**
+ * @brief Number of packets a frame of numLeds LEDs takes with a protocol.
+ */
+size_t WLedDevice::getPacketCount(Protocol protocol, size_t numLeds) const {
+    switch (protocol) {
+        case Protocol::Dnrgb:
+            return (numLeds + WLED_DNRGB_MAX_LEDS - 1u) / WLED_DNRGB_MAX_LEDS;
+        case Protocol::Ddp:
+            return (numLeds * _byteCountForEachLed + DDP_MAX_DATA_BYTES - 1u) / DDP_MAX_DATA_BYTES;
+        case Protocol::Drgb:
+        default:
+            return 1u;
+    }
+}
+
+/**
+ * @brief Sizes the packet list for the LED count under any protocol, so neither a new configuration nor
+ * setProtocol() leaves encode() short of packets. Only allocates when the strip gets longer.
+ *
+ * @param numLeds The configured number of LEDs.
+ */
+void WLedDevice::reservePackets(size_t numLeds) {
+    const size_t count = std::max({getPacketCount(Protocol::Drgb, numLeds), getPacketCount(Protocol::Dnrgb, numLeds),
+                                   getPacketCount(Protocol::Ddp, numLeds)});
+    if (count > _packets.size()) _packets.resize(count);
+}
+
+/**
+ * @brief Connects the socket to the configured address, so sending needs no address lookup.
+ */
+void WLedDevice::connectSocket() {
+    const Config* config = _config.get();
+    if (!config || 0 > connect(_sckt, reinterpret_cast<const sockaddr*>(&config->addr), sizeof(config->addr))) {
+        LOGE("Failed to connect to device, with the provided address & port");
+    }
+}
 
-    _numLeds = numLeds;
+/**
+ * @brief Selects the wire protocol used by flush(), must not be called while flushing.
+ *
+ * @param protocol The protocol, DNRGB or DDP are needed for more than WLED_DRGB_MAX_LEDS LEDs.
+ */
+void WLedDevice::setProtocol(Protocol protocol) {
+    _protocol = protocol;
+    _ddpSequence = 0u;
 }
 
 /**
  * @brief Activates the WLedDevice by opening a UDP socket and connecting to the device at the specified IP address and port.
+ * The calling thread becomes the flushing thread until the device is deactivated.
  * This function attempts to create a socket for communication and connect to the device. If successful, it returns true.
  *
  * @return true if the socket is successfully created and connected to the device, false otherwise.
@@ -51,13 +119,13 @@ bool res(true);
 
     _sckt = socket(AF_INET,SOCK_DGRAM,0);
 
-    if (!_sckt) {
+    if (0 > _sckt) {
         res = false;
         LOGE("Not able to open socket for wled device");
-    } else{
-        if(0> connect(_sckt,(sockaddr*)&_addr,sizeof(_addr))){
-            LOGE("Failed to connect to device, with the provided address & port");
-        }
+    } else {
+        // A newly published configuration connects the socket as it is adopted, the current one is connected here.
+        const Config* previous = _config.get();
+        if (previous == acquireConfig()) connectSocket();
     }
     return res;
 }
@@ -71,38 +139,174 @@ bool res(true);
 bool WLedDevice::deactivate() {
     bool res(false);
 
-    if(_sckt){
+    if(0 <= _sckt){
         if(0 > close(_sckt))
             LOGE("Failed to closed already opened socket for wled device");
         else
             res= true;
+        _sckt = -1;
     }
     return res;
 }
 
 /**
- * @brief Sends LED control data to the WLedDevice over the active socket.
- * The data includes control bytes (protocol and timeout) and LED data.
- * This method sends the data over the network to control the LEDs based on the configured settings.
+ * @brief Sends one datagram on the connected socket, gathered from a protocol header and a span of the LED data.
+ * The socket is never waited on: when its send buffer is full the packet is reported busy and the caller drops
+ * the rest of the frame, the next frame goes out as usual.
+ *
+ * @param header The protocol header of the packet.
+ * @param headerBytes The number of header bytes.
+ * @param leds The LED data of the packet, sent in place.
+ * @param ledBytes The number of LED data bytes.
+ *
+ * @return Sent if the whole packet was sent, Busy if the send buffer was full, Failed on a socket error.
+ */
+WLedDevice::SendResult WLedDevice::sendPacket(const uint8_t* header, size_t headerBytes, const uint8_t* leds, size_t ledBytes) {
+    iovec iov[2];
+    iov[0].iov_base = const_cast<uint8_t*>(header);
+    iov[0].iov_len = headerBytes;
+    iov[1].iov_base = const_cast<uint8_t*>(leds);
+    iov[1].iov_len = ledBytes;
+
+    msghdr msg{};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+
+    ssize_t sent;
+    do {
+        sent = sendmsg(_sckt, &msg, MSG_DONTWAIT);
+    } while (0 > sent && EINTR == errno);
+
+    if (static_cast<ssize_t>(headerBytes + ledBytes) == sent) return SendResult::Sent;
+    if (0 > sent && (EAGAIN == errno || EWOULDBLOCK == errno)) return SendResult::Busy;
+    _sendFailureCount.fetch_add(1u, std::memory_order_relaxed);
+    return SendResult::Failed;
+}
+
+/**
+ * @brief Sends LED data to the WLedDevice over the active socket, see encode() and send().
  *
- * @param data Pointer to the data buffer containing LED control data and protocol information.
- * @param numBytes The total number of bytes to be sent, which should match the expected data length.
+ * @param config The configuration of this frame, returned by acquireConfig().
+ * @param leds Pointer to the RGB data, _byteCountForEachLed bytes per LED.
+ * @param numBytes The total number of bytes to be sent, which should match the configured number of LEDs.
  *
  * @return true if the data was successfully sent to the device, false otherwise.
  */
-bool WLedDevice::flush(uint8_t *data, size_t numBytes) {
-    bool res(false);
-    // check total bytes is equal to LEDS * bytes for each led + protocol selection byte + timeout selection byte.
-    if(((_numLeds*_byteCountForEachLed+2) == numBytes) && (_sckt)){
-        data[0]=_protocol;
-        data[1]=_timeOutSec;
-        if(!send(_sckt,data,numBytes,0))
-            LOGE("Failed to send data, socket error");
-        else
-            res= true;
+bool WLedDevice::flush(const Config& config, const uint8_t *leds, size_t numBytes) {
+    return encode(config, leds, numBytes) && send();
+}
 
-    } else{
-        LOGE("Failed to send data, check number of leds or socket descriptor");
+/**
+ * @brief Splits a frame into the packets of the selected protocol, without sending them yet.
+ * Every packet is a small header and a span of the caller's buffer, so the LED data is never copied and
+ * needs no room for the wire format, it must stay unchanged until send(). With DRGB the frame goes out as a
+ * single packet, DNRGB and DDP split it into as many packets as needed.
+ * The configuration is the one acquireConfig() returned for this frame, adopting it sized the packet list,
+ * so encoding never allocates.
+ *
+ * @param config The configuration of this frame, returned by acquireConfig().
+ * @param leds Pointer to the RGB data, _byteCountForEachLed bytes per LED.
+ * @param numBytes The total number of bytes, which should match the configured number of LEDs.
+ *
+ * @return true if the frame is ready to be sent, false if it doesn't match the configuration or protocol.
+ */
+bool WLedDevice::encode(const Config& config, const uint8_t *leds, size_t numBytes) {
+    _packetCount = 0u;
+    const size_t numLeds = config.numLeds;
+    // check total bytes is equal to LEDS * bytes for each led.
+    if (((numLeds*_byteCountForEachLed) != numBytes) || (0 > _sckt)) {
+        return reportResult(SendResult::Failed, "check number of leds or socket descriptor");
     }
-    return res;
-}
\ No newline at end of file
+    // acquireConfig() sized the packet list for this LED count.
+    if (getPacketCount(_protocol, numLeds) > _packets.size()) {
+        return reportResult(SendResult::Failed, "packet list not sized for the configuration");
+    }
+
+    switch (_protocol) {
+        case Protocol::Drgb: {
+            if (numLeds > WLED_DRGB_MAX_LEDS) {
+                return reportResult(SendResult::Failed, "too many LEDs for DRGB, use DNRGB or DDP");
+            }
+            Packet& packet = _packets[_packetCount++];
+            packet.header[0] = 2u;
+            packet.header[1] = _timeOutSec;
+            packet.headerBytes = 2u;
+            packet.leds = leds;
+            packet.ledBytes = numBytes;
+            break;
+        }
+
+        case Protocol::Dnrgb:
+            for (size_t start = 0; start < numLeds; start += WLED_DNRGB_MAX_LEDS) {
+                const size_t count = std::min<size_t>(WLED_DNRGB_MAX_LEDS, numLeds - start);
+                Packet& packet = _packets[_packetCount++];
+                packet.header[0] = 4u;
+                packet.header[1] = _timeOutSec;
+                packet.header[2] = static_cast<uint8_t>(start >> 8);
+                packet.header[3] = static_cast<uint8_t>(start & 0xFFu);
+                packet.headerBytes = 4u;
+                packet.leds = leds + start * _byteCountForEachLed;
+                packet.ledBytes = count * _byteCountForEachLed;
+            }
+            break;
+
+        case Protocol::Ddp:
+            for (size_t offset = 0; offset < numBytes; offset += DDP_MAX_DATA_BYTES) {
+                const size_t length = std::min<size_t>(DDP_MAX_DATA_BYTES, numBytes - offset);
+                const bool isLast = offset + length == numBytes;
+                // Sequence numbers run from 1 to 15, 0 would disable the receiver's checks.
+                _ddpSequence = static_cast<uint8_t>(_ddpSequence % 15u + 1u);
+                Packet& packet = _packets[_packetCount++];
+                packet.header[0] = isLast ? 0x41u : 0x40u;  // Version 1, push on the last packet.
+                packet.header[1] = _ddpSequence;
+                packet.header[2] = 0x0Bu;                   // RGB, 8 bits per channel.
+                packet.header[3] = 1u;                      // Default output device.
+                packet.header[4] = static_cast<uint8_t>(offset >> 24);
+                packet.header[5] = static_cast<uint8_t>(offset >> 16);
+                packet.header[6] = static_cast<uint8_t>(offset >> 8);
+                packet.header[7] = static_cast<uint8_t>(offset);
+                packet.header[8] = static_cast<uint8_t>(length >> 8);
+                packet.header[9] = static_cast<uint8_t>(length);
+                packet.headerBytes = DDP_HEADER_BYTES;
+                packet.leds = leds + offset;
+                packet.ledBytes = length;
+            }
+            break;
+    }
+    return true;
+}
+
+/**
+ * @brief Sends the packets of the last encoded frame.
+ * Only the first failure of a series is logged, later ones are counted, see getSendFailureCount().
+ * A full send buffer drops the rest of the frame without counting it as a failure.
+ *
+ * @return true if the whole frame was sent, false otherwise.
+ */
+bool WLedDevice::send() {
+    if (0u == _packetCount) return false;  // Nothing encoded, encode() reported why.
+    SendResult res(SendResult::Sent);
+    for (size_t i = 0; i < _packetCount && SendResult::Sent == res; i++) {
+        const Packet& packet = _packets[i];
+        res = sendPacket(packet.header, packet.headerBytes, packet.leds, packet.ledBytes);
+    }
+    _packetCount = 0u;
+    return reportResult(res, "socket error");
+}
+
+/**
+ * @brief Logs the first failure of a series.
+ *
+ * @param res The result of the frame.
+ * @param error The reason of a failure.
+ *
+ * @return true if the frame was sent.
+ */
+bool WLedDevice::reportResult(SendResult res, const char* error) {
+    const bool isFailed = SendResult::Failed == res;
+    if (isFailed && !_isFailing) {
+        LOGE("Failed to send data, %s", error);
+    }
+    _isFailing = isFailed;
+    return SendResult::Sent == res;
+}
@@ -6,27 +6,87 @@
 #define LEDFX_WLEDDEVICE_H
 
 #include <unistd.h>
+#include <atomic>
+#include <string>
+#include <vector>
 #include <types.h>
 #include <numeric>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include "SnapshotExchange.h"
 
 
+#define WLED_DRGB_MAX_LEDS 490u     // Single packet limit of the DRGB protocol.
+#define WLED_DNRGB_MAX_LEDS 489u    // LEDs per DNRGB packet, frames are split across packets.
+#define DDP_HEADER_BYTES 10u
+#define DDP_MAX_DATA_BYTES 1440u    // Data bytes per DDP packet (480 RGB pixels), fits in one Ethernet frame.
+
 class WLedDevice {
-size_t _numLeds =0u;
+public:
+/**
+ * Wire protocols, DRGB and DNRGB are WLED's UDP realtime protocols, DDP is the Distributed Display Protocol.
+ */
+enum class Protocol {
+    Drgb,   // One packet per frame, up to WLED_DRGB_MAX_LEDS.
+    Dnrgb,  // Packets with a start index, for longer strips.
+    Ddp     // Packets with a byte offset, a sequence number and a push flag on the last packet of the frame.
+};
+
+/**
+ * Immutable output configuration, published by updateConfig() and picked up by the thread that flushes.
+ */
+struct Config {
+    sockaddr_in addr;
+    size_t numLeds;
+};
+
+private:
+SnapshotExchange<Config> _config;
 uint8_t _timeOutSec = 1u;
-uint8_t _protocol = 2u; // DRGB protocol.
+Protocol _protocol = Protocol::Drgb;
 uint8_t _byteCountForEachLed = 3u;
+uint8_t _ddpSequence = 0u;
+bool _isFailing = false;  // The last flush failed, its error was logged.
+std::atomic<uint64_t> _sendFailureCount{0u};
 int _sckt = -1;
-sockaddr_in _addr;
+
+enum class SendResult {
+    Sent,
+    Busy,   // The socket's send buffer is full, the packet was not sent.
+    Failed
+};
+
+/**
+ * One datagram of an encoded frame, its header and a span of the caller's LED data.
+ */
+struct Packet {
+    uint8_t header[DDP_HEADER_BYTES];
+    uint8_t headerBytes;
+    const uint8_t* leds;
+    size_t ledBytes;
+};
+std::vector<Packet> _packets;   // Packets of the encoded frame, sized by reservePackets() for the configured LEDs.
+size_t _packetCount = 0u;
+
+void connectSocket();
+size_t getPacketCount(Protocol protocol, size_t numLeds) const;
+void reservePackets(size_t numLeds);
+SendResult sendPacket(const uint8_t* header, size_t headerBytes, const uint8_t* leds, size_t ledBytes);
+bool reportResult(SendResult res, const char* error);
 
 public:
 WLedDevice();
 bool activate(void);
 bool deactivate(void);
-bool flush(uint8_t* data, size_t numBytes);
+bool flush(const Config& config, const uint8_t* leds, size_t numBytes);
+bool encode(const Config& config, const uint8_t* leds, size_t numBytes);
+bool send();
 void updateConfig(std::string ipAddr, uint16_t portNum, size_t numLeds);
+const Config* acquireConfig();
+const Config* getConfig() const { return _config.get(); }
+void setProtocol(Protocol protocol);
+uint64_t getSendFailureCount() const { return _sendFailureCount.load(std::memory_order_relaxed); }
 };
 
 
@@ -16,13 +16,14 @@
  */
 #ifndef __SAMPLE_ANDROID_DEBUG_H__
 #define __SAMPLE_ANDROID_DEBUG_H__
-#include <android/log.h>
 
-#if 1
 #ifndef MODULE_NAME
 #define MODULE_NAME  "AUDIO-APP"
 #endif
 
+#if defined(__ANDROID__)
+#include <android/log.h>
+
 #define LOGV(...) __android_log_print(ANDROID_LOG_VERBOSE, MODULE_NAME, __VA_ARGS__)
 #define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, MODULE_NAME, __VA_ARGS__)
 #define LOGI(...) __android_log_print(ANDROID_LOG_INFO, MODULE_NAME, __VA_ARGS__)
@@ -31,6 +32,19 @@
 #define LOGF(...) __android_log_print(ANDROID_LOG_FATAL,MODULE_NAME, __VA_ARGS__)
 
 #define ASSERT(cond, ...) if (!(cond)) {__android_log_assert(#cond, MODULE_NAME, __VA_ARGS__);}
+#elif defined(LEDFX_HOST_LOGGING)
+// Host builds (tools), warnings and errors go to stderr, the rest is dropped.
+#include <cstdio>
+#include <cstdlib>
+
+#define LOGV(...)
+#define LOGD(...)
+#define LOGI(...)
+#define LOGW(...) (fprintf(stderr, MODULE_NAME " W: " __VA_ARGS__), fputc('\n', stderr))
+#define LOGE(...) (fprintf(stderr, MODULE_NAME " E: " __VA_ARGS__), fputc('\n', stderr))
+#define LOGF(...) (fprintf(stderr, MODULE_NAME " F: " __VA_ARGS__), fputc('\n', stderr))
+
+#define ASSERT(cond, ...) if (!(cond)) {LOGF(__VA_ARGS__); abort();}
 #else
 
 #define LOGV(...)
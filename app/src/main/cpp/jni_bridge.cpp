@@ -1,83 +1,262 @@
 #include <jni.h>
 #include <logging_macros.h>
+#include <mutex>
+#include <unordered_map>
 #include "LedfxEngine.h"
+#include "OutputSender.h"
+#include "ThreadScheduling.h"
 
 static const int kOboeApiAAudio = 0;
 static const int kOboeApiOpenSLES = 1;
 
-static LedfxEngine *engine = nullptr;
+static const int kProtocolDrgb = 0;
+static const int kProtocolDnrgb = 1;
+static const int kProtocolDdp = 2;
+
+// Engines are referred to from Java by handles, never by address, so a stale handle can't reach a deleted engine.
+static std::mutex engineLock;
+static std::unordered_map<jlong, std::shared_ptr<LedfxEngine>> engines;
+static jlong nextEngineHandle = 1;
+static std::weak_ptr<OutputSender> sharedSender;  // Lives as long as one of the engines.
+static ThreadScheduling workerScheduling{WORKER_FIFO_PRIORITY, WORKER_NICE_LEVEL, 0u};
+
+/**
+ * Looks up an engine, the caller keeps it alive even if it is deleted concurrently.
+ * @param handle The handle returned by create().
+ * @return The engine, nullptr if the handle is unknown.
+ */
+static std::shared_ptr<LedfxEngine> findEngine(jlong handle) {
+    std::lock_guard<std::mutex> lock(engineLock);
+    const auto it = engines.find(handle);
+    if (it == engines.end()) {
+        LOGE(
+            "Engine %lld is unknown, you must call create before calling this "
+            "method", static_cast<long long>(handle));
+        return nullptr;
+    }
+    return it->second;
+}
 
 extern "C" {
 
-JNIEXPORT jboolean JNICALL
+JNIEXPORT jlong JNICALL
 Java_com_example_ledfx_LedfxEngine_create(JNIEnv *env, jclass) {
-    if (engine == nullptr) {
-        engine = new LedfxEngine();
+    std::lock_guard<std::mutex> lock(engineLock);
+    std::shared_ptr<OutputSender> sender = sharedSender.lock();
+    if (!sender) {
+        // The sender thread and one pool worker per remaining core, the pool caps the count.
+        const size_t coreCount = std::thread::hardware_concurrency();
+        sender = std::make_shared<OutputSender>(coreCount > 1u ? coreCount - 1u : 0u);
+        sender->setScheduling(workerScheduling);
+        sharedSender = sender;
     }
 
-    return (engine != nullptr) ? JNI_TRUE : JNI_FALSE;
+    const jlong handle = nextEngineHandle++;
+    engines.emplace(handle, std::make_shared<LedfxEngine>(sender));
+    return handle;
+}
+
+JNIEXPORT void JNICALL
+Java_com_example_ledfx_LedfxEngine_delete(JNIEnv *env, jclass, jlong handle) {
+    std::shared_ptr<LedfxEngine> engine;
+    {
+        std::lock_guard<std::mutex> lock(engineLock);
+        const auto it = engines.find(handle);
+        if (it == engines.end()) return;
+        engine = std::move(it->second);
+        engines.erase(it);
+    }
+    // Destroyed here, or by the last call still using it, which turns the effect off.
 }
 
 JNIEXPORT void JNICALL
-Java_com_example_ledfx_LedfxEngine_delete(JNIEnv *env, jclass) {
-    if (engine) {
-        engine->setEffectOn(false);
-        delete engine;
-        engine = nullptr;
+Java_com_example_ledfx_LedfxEngine_setWorkerScheduling(
+        JNIEnv *env, jclass, jint fifoPriority, jint niceLevel, jboolean isBigCoresOnly) {
+    std::lock_guard<std::mutex> lock(engineLock);
+    workerScheduling.fifoPriority = fifoPriority;
+    workerScheduling.niceLevel = niceLevel;
+    workerScheduling.cpuMask = isBigCoresOnly ? ThreadScheduling::getBigCoreMask() : 0u;
+    if (std::shared_ptr<OutputSender> sender = sharedSender.lock()) {
+        sender->setScheduling(workerScheduling);
     }
 }
 
+JNIEXPORT jlongArray JNICALL
+Java_com_example_ledfx_LedfxEngine_getWorkerSchedulingStats(
+        JNIEnv *env, jclass) {
+    std::array<jlong, 7> stats{};
+    {
+        std::lock_guard<std::mutex> lock(engineLock);
+        stats[6] = static_cast<jlong>(workerScheduling.cpuMask);
+        if (std::shared_ptr<OutputSender> sender = sharedSender.lock()) {
+            stats[0] = static_cast<jlong>(sender->getPolicy());
+            stats[1] = static_cast<jlong>(sender->getPool().getPolicy());
+            stats[2] = sender->getWakeupLatency().getMeanNs();
+            stats[3] = sender->getWakeupLatency().getMaxNs();
+            stats[4] = sender->getPool().getWakeupLatency().getMeanNs();
+            stats[5] = sender->getPool().getWakeupLatency().getMaxNs();
+        }
+    }
+    jlongArray result = env->NewLongArray(stats.size());
+    env->SetLongArrayRegion(result, 0, stats.size(), stats.data());
+    return result;
+}
+
 JNIEXPORT jboolean JNICALL
 Java_com_example_ledfx_LedfxEngine_setEffectOn(
-    JNIEnv *env, jclass, jboolean isEffectOn) {
-    if (engine == nullptr) {
-        LOGE(
-            "Engine is null, you must call createEngine before calling this "
-            "method");
-        return JNI_FALSE;
-    }
+    JNIEnv *env, jclass, jlong handle, jboolean isEffectOn) {
+    const std::shared_ptr<LedfxEngine> engine = findEngine(handle);
+    if (!engine) return JNI_FALSE;
 
     return engine->setEffectOn(isEffectOn) ? JNI_TRUE : JNI_FALSE;
 }
 
 JNIEXPORT void JNICALL
 Java_com_example_ledfx_LedfxEngine_updateConfig(
-        JNIEnv *env, jclass,jstring iPaddr, jint portNum, jlong numLeds) {
-    if (engine == nullptr) {
-        LOGE(
-                "Engine is null, you must call createEngine before calling this "
-                "method");
-        return ;
-    }
-    const char* ip = env->GetStringUTFChars(iPaddr,0);
+        JNIEnv *env, jclass, jlong handle, jstring iPaddr, jint portNum, jlong numLeds) {
+    const std::shared_ptr<LedfxEngine> engine = findEngine(handle);
+    if (!engine) return;
+    const char* ip = iPaddr ? env->GetStringUTFChars(iPaddr,0) : nullptr;
+    if (!ip) return;
 
      engine->updateConfig(std::string (ip),(uint16_t)portNum,(size_t)numLeds);
+    env->ReleaseStringUTFChars(iPaddr, ip);
 }
 
 
+JNIEXPORT void JNICALL
+Java_com_example_ledfx_LedfxEngine_setStereoAnalysis(
+        JNIEnv *env, jclass, jlong handle, jboolean isStereo) {
+    const std::shared_ptr<LedfxEngine> engine = findEngine(handle);
+    if (!engine) return;
+
+    engine->setStereoAnalysis(isStereo);
+}
+
+JNIEXPORT jintArray JNICALL
+Java_com_example_ledfx_LedfxEngine_getQualityStats(
+        JNIEnv *env, jclass, jlong handle) {
+    const std::shared_ptr<LedfxEngine> engine = findEngine(handle);
+    if (!engine) return nullptr;
+
+    const std::array<int32_t, 3> stats = engine->getQualityStats();
+    jintArray result = env->NewIntArray(stats.size());
+    env->SetIntArrayRegion(result, 0, stats.size(), stats.data());
+    return result;
+}
+
+JNIEXPORT jlongArray JNICALL
+Java_com_example_ledfx_LedfxEngine_getEngineStats(
+        JNIEnv *env, jclass, jlong handle) {
+    const std::shared_ptr<LedfxEngine> engine = findEngine(handle);
+    if (!engine) return nullptr;
+
+    const EngineStats::Values values = engine->getEngineStats();
+    const std::array<jlong, 9> stats = {
+            static_cast<jlong>(values.callbacks),
+            static_cast<jlong>(values.analyzedHops),
+            static_cast<jlong>(values.renderedFrames),
+            static_cast<jlong>(values.sentFrames),
+            static_cast<jlong>(values.droppedFrames),
+            static_cast<jlong>(values.sendFailures),
+            static_cast<jlong>(values.xRunCount),
+            static_cast<jlong>(values.outputFps * 100.0f),
+            values.isSilent ? 1 : 0};
+    jlongArray result = env->NewLongArray(stats.size());
+    env->SetLongArrayRegion(result, 0, stats.size(), stats.data());
+    return result;
+}
+
+JNIEXPORT jlongArray JNICALL
+Java_com_example_ledfx_LedfxEngine_getInputSwitchStats(
+        JNIEnv *env, jclass, jlong handle) {
+    const std::shared_ptr<LedfxEngine> engine = findEngine(handle);
+    if (!engine) return nullptr;
+
+    const std::array<int64_t, 2> stats = engine->getInputSwitchStats();
+    jlongArray result = env->NewLongArray(stats.size());
+    env->SetLongArrayRegion(result, 0, stats.size(), reinterpret_cast<const jlong*>(stats.data()));
+    return result;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_ledfx_LedfxEngine_setFixedPointAnalysis(
+        JNIEnv *env, jclass, jlong handle, jboolean isFixedPoint) {
+    const std::shared_ptr<LedfxEngine> engine = findEngine(handle);
+    if (!engine) return JNI_FALSE;
+
+    return engine->setFixedPointAnalysis(isFixedPoint) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_ledfx_LedfxEngine_setLogSpectrumBands(
+        JNIEnv *env, jclass, jlong handle, jint bandCount) {
+    const std::shared_ptr<LedfxEngine> engine = findEngine(handle);
+    if (!engine) return JNI_FALSE;
+
+    return engine->setLogSpectrumBands(bandCount) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_ledfx_LedfxEngine_setMultiResolutionAnalysis(
+        JNIEnv *env, jclass, jlong handle, jboolean isMultiResolution) {
+    const std::shared_ptr<LedfxEngine> engine = findEngine(handle);
+    if (!engine) return JNI_FALSE;
+
+    return engine->setMultiResolutionAnalysis(isMultiResolution) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_ledfx_LedfxEngine_setFrameLogPath(
+        JNIEnv *env, jclass, jlong handle, jstring path) {
+    const std::shared_ptr<LedfxEngine> engine = findEngine(handle);
+    if (!engine) return JNI_FALSE;
+
+    // GetStringUTFChars returns null, with an OutOfMemoryError pending, if it can't convert the string.
+    const char* chars = path ? env->GetStringUTFChars(path, nullptr) : nullptr;
+    if (!chars) return JNI_FALSE;
+    const bool res = engine->setFrameLogPath(std::string(chars));
+    env->ReleaseStringUTFChars(path, chars);
+    return res ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_ledfx_LedfxEngine_startReplay(
+        JNIEnv *env, jclass, jlong handle, jstring path, jboolean isLooping) {
+    const std::shared_ptr<LedfxEngine> engine = findEngine(handle);
+    if (!engine) return JNI_FALSE;
+
+    const char* chars = path ? env->GetStringUTFChars(path, nullptr) : nullptr;
+    if (!chars) return JNI_FALSE;
+    const bool res = engine->startReplay(std::string(chars), isLooping);
+    env->ReleaseStringUTFChars(path, chars);
+    return res ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT void JNICALL
+Java_com_example_ledfx_LedfxEngine_stopReplay(
+        JNIEnv *env, jclass, jlong handle) {
+    const std::shared_ptr<LedfxEngine> engine = findEngine(handle);
+    if (!engine) return;
+
+    engine->stopReplay();
+}
+
 JNIEXPORT void JNICALL
 Java_com_example_ledfx_LedfxEngine_setRecordingDeviceId(
-    JNIEnv *env, jclass, jint deviceId) {
-    if (engine == nullptr) {
-        LOGE(
-            "Engine is null, you must call createEngine before calling this "
-            "method");
-        return;
-    }
+    JNIEnv *env, jclass, jlong handle, jint deviceId) {
+    const std::shared_ptr<LedfxEngine> engine = findEngine(handle);
+    if (!engine) return;
 
     engine->setRecordingDeviceId(deviceId);
 }
 
 JNIEXPORT jboolean JNICALL
 Java_com_example_ledfx_LedfxEngine_setAPI(JNIEnv *env,
-                                          jclass type,
+                                          jclass type, jlong handle,
                                           jint apiType) {
-    if (engine == nullptr) {
-        LOGE(
-            "Engine is null, you must call createEngine "
-            "before calling this method");
-        return JNI_FALSE;
-    }
+    const std::shared_ptr<LedfxEngine> engine = findEngine(handle);
+    if (!engine) return JNI_FALSE;
 
     oboe::AudioApi audioApi;
     switch (apiType) {
@@ -96,14 +275,36 @@ Java_com_example_ledfx_LedfxEngine_setAPI(JNIEnv *env,
 }
 
 JNIEXPORT jboolean JNICALL
-Java_com_example_ledfx_LedfxEngine_isAAudioRecommended(
-    JNIEnv *env, jclass type) {
-    if (engine == nullptr) {
-        LOGE(
-            "Engine is null, you must call createEngine "
-            "before calling this method");
-        return JNI_FALSE;
+Java_com_example_ledfx_LedfxEngine_setOutputProtocol(JNIEnv *env,
+                                                     jclass type, jlong handle,
+                                                     jint protocolType) {
+    const std::shared_ptr<LedfxEngine> engine = findEngine(handle);
+    if (!engine) return JNI_FALSE;
+
+    WLedDevice::Protocol protocol;
+    switch (protocolType) {
+        case kProtocolDrgb:
+            protocol = WLedDevice::Protocol::Drgb;
+            break;
+        case kProtocolDnrgb:
+            protocol = WLedDevice::Protocol::Dnrgb;
+            break;
+        case kProtocolDdp:
+            protocol = WLedDevice::Protocol::Ddp;
+            break;
+        default:
+            LOGE("Unknown protocol selection to setOutputProtocol() %d", protocolType);
+            return JNI_FALSE;
     }
+
+    return engine->setOutputProtocol(protocol) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_ledfx_LedfxEngine_isAAudioRecommended(
+    JNIEnv *env, jclass type, jlong handle) {
+    const std::shared_ptr<LedfxEngine> engine = findEngine(handle);
+    if (!engine) return JNI_FALSE;
     return engine->isAAudioRecommended() ? JNI_TRUE : JNI_FALSE;
 }
 
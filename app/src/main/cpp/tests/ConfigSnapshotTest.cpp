@@ -0,0 +1,95 @@
+/**
+ * Stress test of the configuration snapshots of WLedDevice: a publisher thread changes the LED count and the
+ * port while the flushing thread acquires a configuration per frame and encodes and sends frames sized for it.
+ * Every frame must encode against the configuration acquired for it, whatever is published meanwhile.
+ * Meant to be run under ThreadSanitizer and AddressSanitizer as well.
+ */
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include "WLedDevice.h"
+#include "TestCheck.h"
+
+#define TEST_UPDATES 20000u
+#define TEST_MAX_LEDS 1500u
+
+/**
+ * Opens a loopback UDP socket on a free port, so the frames sent to it are accepted and then dropped unread.
+ * @return the socket, its port in port.
+ */
+static int openSink(uint16_t& port) {
+    const int sckt = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(addr);
+    if (0 > sckt || 0 > bind(sckt, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) ||
+        0 > getsockname(sckt, reinterpret_cast<sockaddr*>(&addr), &length)) {
+        return -1;
+    }
+    port = ntohs(addr.sin_port);
+    return sckt;
+}
+
+int main() {
+    uint16_t ports[2];
+    const int sinks[2] = {openSink(ports[0]), openSink(ports[1])};
+    if (0 > sinks[0] || 0 > sinks[1]) {
+        fprintf(stderr, "FAILED: no loopback socket\n");
+        return EXIT_FAILURE;
+    }
+
+    WLedDevice device;
+    device.updateConfig("127.0.0.1", ports[0], 60u);
+    // DDP splits long strips into several packets, so a count change between two packets would show.
+    device.setProtocol(WLedDevice::Protocol::Ddp);
+    check(device.activate(), "activate");
+
+    std::atomic<bool> isPublishing{true};
+    std::thread publisher([&] {
+        for (size_t i = 0; i < TEST_UPDATES; i++) {
+            device.updateConfig("127.0.0.1", ports[i % 2u], 1u + (i * 7919u) % TEST_MAX_LEDS);
+            // Lets the flushing thread in between updates even on a single core.
+            std::this_thread::yield();
+        }
+        isPublishing.store(false, std::memory_order_release);
+    });
+
+    std::vector<uint8_t> leds(TEST_MAX_LEDS * 3u, 0x55u);
+    size_t frames = 0u, encodeFailures = 0u, configChanges = 0u;
+    const WLedDevice::Config* previous = nullptr;
+    bool isLast = false;
+    while (!isLast) {
+        // One more frame after the publisher is done, so the last configuration is picked up too.
+        isLast = !isPublishing.load(std::memory_order_acquire);
+        const WLedDevice::Config* config = device.acquireConfig();
+        if (!config) {
+            check(false, "no configuration");
+            break;
+        }
+        if (config != previous) configChanges++;
+        previous = config;
+        if (!device.encode(*config, leds.data(), config->numLeds * 3u)) encodeFailures++;
+        device.send();  // A full send buffer drops the frame, that isn't a failure.
+        frames++;
+        std::this_thread::yield();
+    }
+    publisher.join();
+
+    check(0u == encodeFailures, "a frame didn't encode against its own configuration");
+    check(0u == device.getSendFailureCount(), "socket errors");
+    check(1u + (TEST_UPDATES - 1u) * 7919u % TEST_MAX_LEDS == previous->numLeds, "the last configuration was not adopted");
+    check(device.deactivate(), "deactivate");
+    printf("%zu frames, %zu configurations adopted\n", frames, configChanges);
+
+    close(sinks[0]);
+    close(sinks[1]);
+    return isPassing ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,86 @@
+/**
+ * Stress test of the EngineStats sequence lock: a writer publishes 3 million updates whose fields are all
+ * derived from the same counter, while two readers check that every read holds the fields of a single update.
+ * Meant to be run under ThreadSanitizer as well.
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include "EngineStats.h"
+
+#define TEST_UPDATES 3000000u
+#define TEST_READERS 2u
+
+/**
+ * @return the values of update i, every field tells i apart.
+ */
+static EngineStats::Values makeValues(uint64_t i) {
+    EngineStats::Values values;
+    values.callbacks = i;
+    values.analyzedHops = 2u * i;
+    values.renderedFrames = 3u * i;
+    values.sentFrames = 4u * i;
+    values.droppedFrames = 5u * i;
+    values.sendFailures = 6u * i;
+    values.xRunCount = static_cast<int32_t>(i & 0x7FFFFFFFu);
+    values.outputFps = static_cast<float>(i & 0xFFFFu);
+    values.isSilent = 0u != (i & 1u);
+    return values;
+}
+
+static bool isConsistent(const EngineStats::Values& values) {
+    const EngineStats::Values expected = makeValues(values.callbacks);
+    return expected.analyzedHops == values.analyzedHops && expected.renderedFrames == values.renderedFrames &&
+           expected.sentFrames == values.sentFrames && expected.droppedFrames == values.droppedFrames &&
+           expected.sendFailures == values.sendFailures && expected.xRunCount == values.xRunCount &&
+           expected.outputFps == values.outputFps && expected.isSilent == values.isSilent;
+}
+
+int main() {
+    EngineStats stats;
+    std::atomic<bool> isWriting{true};
+    std::atomic<uint64_t> tornReads{0u}, backwardReads{0u}, reads{0u};
+
+    std::vector<std::thread> readers;
+    for (size_t r = 0; r < TEST_READERS; r++) {
+        readers.emplace_back([&] {
+            uint64_t last = 0u, count = 0u;
+            while (isWriting.load(std::memory_order_acquire)) {
+                const EngineStats::Values values = stats.read();
+                if (!isConsistent(values)) tornReads.fetch_add(1u, std::memory_order_relaxed);
+                if (values.callbacks < last) backwardReads.fetch_add(1u, std::memory_order_relaxed);
+                last = values.callbacks;
+                count++;
+                // Lets the writer in between reads even on a single core.
+                if (0u == count % 64u) std::this_thread::yield();
+            }
+            reads.fetch_add(count, std::memory_order_relaxed);
+        });
+    }
+
+    for (uint64_t i = 1u; i <= TEST_UPDATES; i++) {
+        stats.publish(makeValues(i));
+        if (0u == i % 64u) std::this_thread::yield();
+    }
+    isWriting.store(false, std::memory_order_release);
+    for (std::thread& reader : readers) reader.join();
+
+    bool isPassing = true;
+    if (0u != tornReads.load()) {
+        fprintf(stderr, "FAILED: %llu reads mixed two updates\n", static_cast<unsigned long long>(tornReads.load()));
+        isPassing = false;
+    }
+    if (0u != backwardReads.load()) {
+        fprintf(stderr, "FAILED: %llu reads went back in time\n", static_cast<unsigned long long>(backwardReads.load()));
+        isPassing = false;
+    }
+    if (TEST_UPDATES != stats.read().callbacks) {
+        fprintf(stderr, "FAILED: the last update is not read back\n");
+        isPassing = false;
+    }
+    printf("%u updates, %llu reads\n", TEST_UPDATES, static_cast<unsigned long long>(reads.load()));
+    return isPassing ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,85 @@
+/**
+ * Compares the fixed-point analysis with the float one on the same int16 input: 20 s of three tones
+ * pulsing at 120 BPM with a noise floor. The Mel bands, the onsets and the tempo must agree.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+#include "AudioPipeline.h"
+#include "AubioDspProcessor.h"
+#include "FixedPointDspProcessor.h"
+
+#define TEST_HOPS 4600u            // About 20 s.
+#define TEST_SETTLE_HOPS 100u      // Hops skipped before comparing the bands, the smoothing starts from 0.
+#define TEST_MAX_BAND_DEVIATION 0.001
+#define TEST_MAX_ONSET_DEVIATION 0.1
+#define TEST_MAX_BPM_DEVIATION 1.0f
+
+int main() {
+    AubioDspProcessor floatProcessor(FFT_SIZE, HOP_SIZE, FILTER_SIZE, SAMPLE_RATE, MIN_FREQ_HZ, MAX_FREQ_HZ, 2u);
+    FixedPointDspProcessor fixedProcessor(FFT_SIZE, HOP_SIZE, FILTER_SIZE, SAMPLE_RATE, MIN_FREQ_HZ, MAX_FREQ_HZ, 2u);
+    // Next to no smoothing, so the bands of every hop are compared.
+    auto floatBank = std::make_shared<ExpFilter>(0.0f, 0.999f, 0.999f, false, FILTER_SIZE);
+    auto fixedBank = std::make_shared<ExpFilter>(0.0f, 0.999f, 0.999f, false, FILTER_SIZE);
+
+    std::vector<float> floatHop(2u * HOP_SIZE);
+    std::vector<int16_t> fixedHop(2u * HOP_SIZE);
+    std::mt19937 random(1u);
+    std::normal_distribution<float> noise(0.0f, 0.02f);
+    size_t frame = 0u;
+    double deviation = 0.0, sum = 0.0;
+    size_t floatOnsets = 0u, fixedOnsets = 0u;
+
+    for (size_t hop = 0; hop < TEST_HOPS; hop++) {
+        for (size_t i = 0; i < HOP_SIZE; i++, frame++) {
+            const double t = static_cast<double>(frame) / SAMPLE_RATE;
+            const float level = std::fmod(t, 0.5) < 0.05 ? 0.3f : 0.06f;
+            const float sample = level * static_cast<float>(0.5 * std::sin(2.0 * M_PI * 330.0 * t) +
+                                                            0.3 * std::sin(2.0 * M_PI * 1250.0 * t) +
+                                                            0.2 * std::sin(2.0 * M_PI * 2900.0 * t)) + noise(random);
+            // Both processors get the same quantized samples, on both channels.
+            const auto pcm = static_cast<int16_t>(std::lrint(std::min(std::max(sample, -1.0f), 32767.0f / 32768.0f) * 32768.0f));
+            fixedHop[2u * i] = fixedHop[2u * i + 1u] = pcm;
+            floatHop[2u * i] = floatHop[2u * i + 1u] = pcm / 32768.0f;
+        }
+        floatProcessor.doMelBank(floatHop.data(), HOP_SIZE, floatBank);
+        fixedProcessor.doMelBank(fixedHop.data(), HOP_SIZE, fixedBank);
+
+        floatOnsets += floatProcessor.getFeatures().isOnset ? 1u : 0u;
+        fixedOnsets += fixedProcessor.getFeatures().isOnset ? 1u : 0u;
+        if (hop >= TEST_SETTLE_HOPS) {
+            for (size_t band = 0; band < FILTER_SIZE; band++) {
+                deviation += std::fabs(floatBank->valueVec[band] - fixedBank->valueVec[band]);
+                sum += std::fabs(floatBank->valueVec[band]);
+            }
+        }
+    }
+
+    const double bandDeviation = deviation / sum;
+    const double onsetDeviation = std::fabs(static_cast<double>(fixedOnsets) - floatOnsets) / floatOnsets;
+    const float floatBpm = floatProcessor.getFeatures().bpm;
+    const float fixedBpm = fixedProcessor.getFeatures().bpm;
+    printf("Mel bands: mean relative deviation %.4f%%\n", 100.0 * bandDeviation);
+    printf("onsets: %zu float, %zu fixed point\n", floatOnsets, fixedOnsets);
+    printf("tempo: %.2f BPM float, %.2f BPM fixed point\n", floatBpm, fixedBpm);
+
+    bool isPassing = true;
+    if (bandDeviation > TEST_MAX_BAND_DEVIATION) {
+        fprintf(stderr, "FAILED: the Mel bands deviate\n");
+        isPassing = false;
+    }
+    if (onsetDeviation > TEST_MAX_ONSET_DEVIATION) {
+        fprintf(stderr, "FAILED: the onsets deviate\n");
+        isPassing = false;
+    }
+    if (std::fabs(floatBpm - fixedBpm) > TEST_MAX_BPM_DEVIATION || std::fabs(floatBpm - 120.0f) > 2.0f) {
+        fprintf(stderr, "FAILED: the tempo deviates\n");
+        isPassing = false;
+    }
+    return isPassing ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,123 @@
+/**
+ * Round trip of the frame log: frames written by FrameLogWriter and FrameLogRecorder must be read back
+ * unchanged, with their timestamps, from a closed log, after seeking, and from a log that was not closed.
+ */
+
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "FrameLogRecorder.h"
+#include "TestCheck.h"
+
+#define TEST_LEDS 300u
+#define TEST_FRAMES 2000u
+#define TEST_FRAME_US 4354u  // One hop of 192 frames at 44.1 kHz.
+
+/**
+ * Builds frames that exercise every record type: a moving pixel (delta), still frames (empty delta),
+ * plain colours (RLE) and noise (raw).
+ */
+static std::vector<std::vector<uint8_t>> makeFrames() {
+    std::vector<std::vector<uint8_t>> frames(TEST_FRAMES, std::vector<uint8_t>(TEST_LEDS * 3u, 0u));
+    std::mt19937 random(1u);
+    for (size_t f = 0; f < TEST_FRAMES; f++) {
+        std::vector<uint8_t>& frame = frames[f];
+        if (f % 500u < 100u) {
+            for (uint8_t& byte : frame) byte = static_cast<uint8_t>(random());
+        } else if (f % 500u < 200u) {
+            std::fill(frame.begin(), frame.end(), static_cast<uint8_t>(f / 10u));
+        } else if (f % 500u < 300u) {
+            frame = frames[f - 1u];
+        } else {
+            frame[(f % TEST_LEDS) * 3u] = 255u;
+            frame[(f * 7u % TEST_LEDS) * 3u + 1u] = static_cast<uint8_t>(f);
+        }
+    }
+    return frames;
+}
+
+/**
+ * Reads a log from its first frame, or from the key frame found by seeking, and compares it with the frames.
+ * @return the number of frames read.
+ */
+static size_t readBack(const std::string& path, const std::vector<std::vector<uint8_t>>& frames, uint64_t seekUs = 0u) {
+    FrameLogReader reader;
+    check(reader.open(path), "the log can't be opened");
+    check(TEST_LEDS * 3u == reader.getFrameBytes(), "frame size");
+    if (0u != seekUs) check(reader.seek(seekUs), "seek");
+
+    std::vector<uint8_t> frame(reader.getFrameBytes());
+    uint64_t timestampUs = 0u;
+    size_t count = 0u;
+    while (reader.next(frame.data(), timestampUs)) {
+        const size_t f = timestampUs / TEST_FRAME_US;
+        if (f >= frames.size() || f * TEST_FRAME_US != timestampUs || frames[f] != frame) {
+            check(false, "a frame was read back changed");
+            break;
+        }
+        if (0u != seekUs && 0u == count) check(timestampUs <= seekUs, "seek went past the time");
+        count++;
+    }
+    if (0u == seekUs) check(count == reader.getFrameCount(), "frame count of the header or of the scan");
+    return count;
+}
+
+int main() {
+    const char* tmp = getenv("TMPDIR");
+    const std::string base = std::string(tmp ? tmp : "/tmp") + "/FrameLogTest" + std::to_string(getpid());
+    const std::vector<std::vector<uint8_t>> frames = makeFrames();
+
+    // Closed log, read whole and after seeking.
+    FrameLogWriter writer;
+    check(writer.open(base + ".lfx", TEST_LEDS * 3u), "the log can't be created");
+    for (size_t f = 0; f < TEST_FRAMES; f++) {
+        check(writer.append(frames[f].data(), frames[f].size(), f * TEST_FRAME_US), "append");
+    }
+    check(writer.close(), "close");
+    check(TEST_FRAMES == readBack(base + ".lfx", frames), "frames of the closed log");
+    check(TEST_FRAMES / 2u <= readBack(base + ".lfx", frames, TEST_FRAMES / 2u * TEST_FRAME_US + 1u), "frames after seeking");
+
+    // Log that was not closed: a copy taken while it is still being written holds every frame appended so far.
+    check(writer.open(base + ".lfx", TEST_LEDS * 3u), "the log can't be recreated");
+    for (size_t f = 0; f < TEST_FRAMES / 2u; f++) {
+        writer.append(frames[f].data(), frames[f].size(), f * TEST_FRAME_US);
+    }
+    {
+        std::ifstream in(base + ".lfx", std::ios::binary);
+        std::ofstream out(base + "-unclosed.lfx", std::ios::binary);
+        out << in.rdbuf();
+    }
+    writer.close();
+    check(TEST_FRAMES / 2u == readBack(base + "-unclosed.lfx", frames), "frames recovered from the log that was not closed");
+    check(TEST_FRAMES / 4u <= readBack(base + "-unclosed.lfx", frames, TEST_FRAMES / 4u * TEST_FRAME_US), "seeking in the recovered log");
+
+    // Recorder, paced like the audio thread so no frame is dropped.
+    FrameLogRecorder recorder;
+    check(recorder.start(base + ".lfx", TEST_LEDS * 3u), "the recorder can't start");
+    for (size_t f = 0; f < TEST_FRAMES; f++) {
+        check(recorder.append(frames[f].data(), frames[f].size(), f * TEST_FRAME_US), "recorder append");
+        if (0u == f % 16u) std::this_thread::sleep_for(std::chrono::microseconds(500));
+    }
+    check(recorder.stop(), "recorder stop");
+    const size_t recorded = readBack(base + ".lfx", frames);
+    check(TEST_FRAMES == recorded + recorder.getDroppedCount(), "recorded and dropped frames");
+    printf("recorder: %zu frames written, %llu dropped\n", recorded,
+           static_cast<unsigned long long>(recorder.getDroppedCount()));
+
+    // A frame of another size ends the recording.
+    check(recorder.start(base + ".lfx", TEST_LEDS * 3u), "the recorder can't restart");
+    check(!recorder.append(frames[0].data(), frames[0].size() - 3u, 0u), "a frame of another size is refused");
+    check(!recorder.isRecording(), "the recording ends on a frame of another size");
+    recorder.stop();
+
+    unlink((base + ".lfx").c_str());
+    unlink((base + "-unclosed.lfx").c_str());
+    return isPassing ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,72 @@
+/**
+ * Checks that the float analysis switches between full rate and decimated hops without a stale window:
+ * the first spectrum after each switch must match the one of a processor that analyses every hop.
+ * Also checks that the analysed hop count leaves out the hops skipped by the decimation.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+#include "AudioPipeline.h"
+#include "AubioDspProcessor.h"
+
+#define TEST_HOPS 120u
+#define TEST_DECIMATE_HOP 50u  // Switched to every other hop here, an analysis hop.
+#define TEST_RESUME_HOP 71u    // And back to every hop here.
+
+/**
+ * @return the deviation of two Mel outputs, relative to the first one.
+ */
+static double relativeDeviation(const std::vector<float>& reference, const std::vector<float>& values) {
+    double deviation = 0.0, sum = 0.0;
+    for (size_t i = 0; i < reference.size(); i++) {
+        deviation += std::fabs(reference[i] - values[i]);
+        sum += std::fabs(reference[i]);
+    }
+    return deviation / sum;
+}
+
+int main() {
+    // Noise with a slowly changing level, so a window that missed hops gives a different spectrum.
+    std::vector<float> audio(TEST_HOPS * HOP_SIZE);
+    std::mt19937 random(1u);
+    std::normal_distribution<float> noise(0.0f, 0.1f);
+    for (size_t i = 0; i < audio.size(); i++) {
+        audio[i] = noise(random) * (1.0f + std::sin(static_cast<float>(i) * 1e-4f));
+    }
+
+    AubioDspProcessor reference(FFT_SIZE, HOP_SIZE, FILTER_SIZE, SAMPLE_RATE, MIN_FREQ_HZ, MAX_FREQ_HZ);
+    AubioDspProcessor switched(FFT_SIZE, HOP_SIZE, FILTER_SIZE, SAMPLE_RATE, MIN_FREQ_HZ, MAX_FREQ_HZ);
+    // Next to no smoothing, so the banks follow the spectrum of the last analysed hop.
+    auto referenceBank = std::make_shared<ExpFilter>(0.0f, 0.999f, 0.999f, false, FILTER_SIZE);
+    auto switchedBank = std::make_shared<ExpFilter>(0.0f, 0.999f, 0.999f, false, FILTER_SIZE);
+
+    bool isPassing = true;
+    uint64_t expectedHops = 0u;
+    for (size_t hop = 0; hop < TEST_HOPS; hop++) {
+        if (TEST_DECIMATE_HOP == hop) switched.setHopDecimation(2u);
+        if (TEST_RESUME_HOP == hop) switched.setHopDecimation(1u);
+        reference.doMelBank(audio.data() + hop * HOP_SIZE, HOP_SIZE, referenceBank);
+        switched.doMelBank(audio.data() + hop * HOP_SIZE, HOP_SIZE, switchedBank);
+        if (hop < TEST_DECIMATE_HOP || hop >= TEST_RESUME_HOP || 0u == (hop - TEST_DECIMATE_HOP) % 2u) expectedHops++;
+
+        if (TEST_DECIMATE_HOP == hop || TEST_RESUME_HOP == hop) {
+            const double deviation = relativeDeviation(referenceBank->valueVec, switchedBank->valueVec);
+            printf("hop %zu: deviation %.6f\n", hop, deviation);
+            if (deviation > 0.01) {
+                fprintf(stderr, "FAILED: stale analysis window after switching at hop %zu\n", hop);
+                isPassing = false;
+            }
+        }
+    }
+
+    printf("analysed hops: %llu of %u\n", static_cast<unsigned long long>(switched.getAnalyzedHopCount()), TEST_HOPS);
+    if (TEST_HOPS != reference.getAnalyzedHopCount() || expectedHops != switched.getAnalyzedHopCount()) {
+        fprintf(stderr, "FAILED: analysed hop count\n");
+        isPassing = false;
+    }
+    return isPassing ? EXIT_SUCCESS : EXIT_FAILURE;
+}
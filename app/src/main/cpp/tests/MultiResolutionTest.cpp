@@ -0,0 +1,172 @@
+/**
+ * Checks what the multi-resolution analysis is for, against the single FFT analysis on the same Mel bands from
+ * MULTI_RES_MIN_FREQ_HZ: a bass tone leaks much less into the next band, clicks are detected earlier, and two
+ * close bass tones are told apart in the log spectrum. Also checks that its stereo analysis keeps the single FFT
+ * bands from MIN_FREQ_HZ.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+#include "AudioPipeline.h"
+#include "AubioDspProcessor.h"
+#include "TestCheck.h"
+
+#define TEST_TONE_HZ 110.0f
+#define TEST_MAX_LEAKAGE 0.10f      // Next band over the tone band, multi-resolution.
+#define TEST_MIN_LEAKAGE 0.30f      // Same, single FFT, whose 86 Hz bins span several bass bands.
+#define TEST_CLICK_SECONDS 30u
+#define TEST_CLICK_PERIOD 22087u    // Not a multiple of the hop, so clicks land anywhere in a hop.
+#define TEST_CLICK_DETECT 8000u     // Onsets later than this after a click don't count.
+#define TEST_PAIR_LOW_HZ 200.0f     // Two tones less than an 86 Hz bin apart, over 3 long bins apart.
+#define TEST_PAIR_HIGH_HZ 270.0f
+#define TEST_PAIR_AMPLITUDE 0.002f  // Low enough for the log spectrum levels not to clip.
+#define TEST_MIN_DIP 0.10f          // Level dip between the two tones, a 5 dB drop.
+
+static std::unique_ptr<AubioDspProcessor> makeProcessor(bool isMultiResolution, size_t channelCount = 1u) {
+    if (isMultiResolution) {
+        return std::make_unique<AubioDspProcessor>(FFT_SIZE, HOP_SIZE, FILTER_SIZE, SAMPLE_RATE, MIN_FREQ_HZ,
+                                                   MAX_FREQ_HZ, channelCount, true, MULTI_RES_MIN_FREQ_HZ);
+    }
+    return std::make_unique<AubioDspProcessor>(FFT_SIZE, HOP_SIZE, FILTER_SIZE, SAMPLE_RATE, MULTI_RES_MIN_FREQ_HZ,
+                                               MAX_FREQ_HZ, channelCount);
+}
+
+/**
+ * Analyses mono audio hop by hop, and collects the sample at the end of every hop with an onset in onsets,
+ * if not nullptr.
+ */
+static void analyze(AubioDspProcessor& processor, const std::vector<float>& audio, std::shared_ptr<ExpFilter> melBank,
+                    std::vector<size_t>* onsets = nullptr) {
+    for (size_t done = 0; done + HOP_SIZE <= audio.size(); done += HOP_SIZE) {
+        processor.doMelBank(const_cast<float*>(audio.data() + done), HOP_SIZE, melBank);
+        if (onsets && processor.getFeatures().isOnset) onsets->push_back(done + HOP_SIZE);
+    }
+}
+
+static std::vector<float> makeTones(std::initializer_list<float> frequencies, float amplitude) {
+    std::vector<float> audio(SAMPLE_RATE, 0.0f);
+    for (float frequency : frequencies) {
+        for (size_t i = 0; i < audio.size(); i++) {
+            audio[i] += amplitude * std::sin(2.0f * static_cast<float>(M_PI) * frequency * static_cast<float>(i) / SAMPLE_RATE);
+        }
+    }
+    return audio;
+}
+
+/**
+ * @return the level of the loudest band other than the tone band, relative to the tone band.
+ */
+static float measureLeakage(bool isMultiResolution, const std::vector<float>& audio) {
+    auto melBank = std::make_shared<ExpFilter>(0.0f, 0.7f, 0.9f, false, FILTER_SIZE);
+    analyze(*makeProcessor(isMultiResolution), audio, melBank);
+    const std::vector<float>& bands = melBank->valueVec;
+    const size_t peak = std::max_element(bands.begin(), bands.end()) - bands.begin();
+    float next = 0.0f;
+    for (size_t band = 0; band < bands.size(); band++) {
+        if (band != peak) next = std::max(next, bands[band]);
+    }
+    return next / bands[peak];
+}
+
+/**
+ * @return the mean delay between the clicks and their onsets in ms, the number of clicks detected in detected.
+ */
+static double measureOnsetDelay(bool isMultiResolution, const std::vector<float>& audio,
+                                const std::vector<size_t>& clicks, size_t& detected) {
+    auto melBank = std::make_shared<ExpFilter>(0.0f, 0.7f, 0.9f, false, FILTER_SIZE);
+    std::vector<size_t> onsets;
+    analyze(*makeProcessor(isMultiResolution), audio, melBank, &onsets);
+    double totalMs = 0.0;
+    detected = 0u;
+    for (size_t click : clicks) {
+        const auto onset = std::lower_bound(onsets.begin(), onsets.end(), click);
+        if (onset == onsets.end() || *onset >= click + TEST_CLICK_DETECT) continue;
+        totalMs += 1000.0 * static_cast<double>(*onset - click) / SAMPLE_RATE;
+        detected++;
+    }
+    return detected ? totalMs / static_cast<double>(detected) : 0.0;
+}
+
+/**
+ * @return the dip of the log spectrum levels between the bands of two tones, below the lower of the two.
+ */
+static float measureDip(bool isMultiResolution, const std::vector<float>& audio) {
+    std::unique_ptr<AubioDspProcessor> processor = makeProcessor(isMultiResolution);
+    auto logSpectrum = isMultiResolution ?
+            std::make_shared<LogSpectrum>(FFT_SIZE, SAMPLE_RATE, LOG_SPECTRUM_MIN_FREQ_HZ, LOG_SPECTRUM_MAX_FREQ_HZ,
+                                          LOG_SPECTRUM_MAX_BANDS, FFT_SIZE, SAMPLE_RATE / MULTI_RES_DECIMATION,
+                                          MULTI_RES_CROSSOVER_HZ) :
+            std::make_shared<LogSpectrum>(FFT_SIZE, SAMPLE_RATE, LOG_SPECTRUM_MIN_FREQ_HZ, LOG_SPECTRUM_MAX_FREQ_HZ,
+                                          LOG_SPECTRUM_MAX_BANDS);
+    auto levels = std::make_shared<ExpFilter>(0.0f, 0.5f, 0.5f, false, logSpectrum->getBandCount());
+    processor->setLogSpectrum(logSpectrum, levels);
+    analyze(*processor, audio, std::make_shared<ExpFilter>(0.0f, 0.5f, 0.5f, false, FILTER_SIZE));
+
+    // Same band centers as LogSpectrum, geometric from LOG_SPECTRUM_MIN_FREQ_HZ to LOG_SPECTRUM_MAX_FREQ_HZ.
+    const double bands = static_cast<double>(logSpectrum->getBandCount() - 1u);
+    auto bandOf = [&](float frequency) {
+        return static_cast<size_t>(std::lround(bands * std::log(frequency / LOG_SPECTRUM_MIN_FREQ_HZ) /
+                                               std::log(LOG_SPECTRUM_MAX_FREQ_HZ / LOG_SPECTRUM_MIN_FREQ_HZ)));
+    };
+    const std::vector<float>& values = levels->valueVec;
+    const size_t low = bandOf(TEST_PAIR_LOW_HZ), high = bandOf(TEST_PAIR_HIGH_HZ);
+    const float floor = *std::min_element(values.begin() + low, values.begin() + high + 1u);
+    return std::min(values[low], values[high]) - floor;
+}
+
+int main() {
+    const float singleLeakage = measureLeakage(false, makeTones({TEST_TONE_HZ}, 0.2f));
+    const float multiLeakage = measureLeakage(true, makeTones({TEST_TONE_HZ}, 0.2f));
+    printf("%.0f Hz tone, next band: single FFT %.2f%%, multi-resolution %.2f%%\n", TEST_TONE_HZ,
+           100.0f * singleLeakage, 100.0f * multiLeakage);
+    check(multiLeakage < TEST_MAX_LEAKAGE, "the bass tone leaks into the next band");
+    check(singleLeakage > TEST_MIN_LEAKAGE, "the single FFT reference no longer leaks, the comparison is moot");
+
+    // Short decaying clicks over a faint low tone, so no other onset is detected.
+    std::vector<float> clickAudio(TEST_CLICK_SECONDS * SAMPLE_RATE, 0.0f);
+    std::vector<size_t> clicks;
+    for (size_t click = SAMPLE_RATE / 2u + 77u; click + 2000u < clickAudio.size(); click += TEST_CLICK_PERIOD) {
+        clicks.push_back(click);
+        for (size_t i = 0; i < 300u; i++) {
+            clickAudio[click + i] += 0.5f * std::exp(-static_cast<float>(i) / 60.0f) * std::sin(static_cast<float>(i) * 1.9f);
+        }
+    }
+    for (size_t i = 0; i < clickAudio.size(); i++) clickAudio[i] += 0.01f * std::sin(static_cast<float>(i) * 0.013f);
+    size_t singleDetected = 0u, multiDetected = 0u;
+    const double singleDelay = measureOnsetDelay(false, clickAudio, clicks, singleDetected);
+    const double multiDelay = measureOnsetDelay(true, clickAudio, clicks, multiDetected);
+    printf("onsets of %zu clicks: single FFT %zu after %.2f ms, multi-resolution %zu after %.2f ms\n", clicks.size(),
+           singleDetected, singleDelay, multiDetected, multiDelay);
+    check(clicks.size() == singleDetected && clicks.size() == multiDetected, "missed clicks");
+    check(multiDelay < singleDelay, "the short FFT doesn't detect the clicks earlier");
+
+    const std::vector<float> pair = makeTones({TEST_PAIR_LOW_HZ, TEST_PAIR_HIGH_HZ}, TEST_PAIR_AMPLITUDE);
+    const float singleDip = measureDip(false, pair);
+    const float multiDip = measureDip(true, pair);
+    printf("log spectrum dip between %.0f and %.0f Hz: single FFT %.3f, multi-resolution %.3f\n", TEST_PAIR_LOW_HZ,
+           TEST_PAIR_HIGH_HZ, singleDip, multiDip);
+    check(multiDip > TEST_MIN_DIP && multiDip > singleDip, "the log spectrum doesn't resolve the two bass tones");
+
+    // The stereo analysis runs on the single FFT, whatever the mono one does.
+    std::vector<float> stereo(2u * SAMPLE_RATE);
+    for (size_t i = 0; i < SAMPLE_RATE; i++) {
+        stereo[2u * i] = 0.2f * std::sin(static_cast<float>(i) * 0.02f);
+        stereo[2u * i + 1u] = 0.1f * std::sin(static_cast<float>(i) * 0.11f);
+    }
+    AubioDspProcessor reference(FFT_SIZE, HOP_SIZE, FILTER_SIZE, SAMPLE_RATE, MIN_FREQ_HZ, MAX_FREQ_HZ, 2u);
+    std::unique_ptr<AubioDspProcessor> multi = makeProcessor(true, 2u);
+    std::shared_ptr<ExpFilter> banks[6];
+    for (auto& bank : banks) bank = std::make_shared<ExpFilter>(0.0f, 0.7f, 0.9f, false, FILTER_SIZE);
+    for (size_t done = 0; done + HOP_SIZE <= SAMPLE_RATE; done += HOP_SIZE) {
+        reference.doStereoMelBank(stereo.data() + 2u * done, HOP_SIZE, banks[0], banks[1], banks[2]);
+        multi->doStereoMelBank(stereo.data() + 2u * done, HOP_SIZE, banks[3], banks[4], banks[5]);
+    }
+    check(banks[0]->valueVec == banks[3]->valueVec && banks[1]->valueVec == banks[4]->valueVec &&
+          banks[2]->valueVec == banks[5]->valueVec, "the stereo analysis doesn't keep the bands from MIN_FREQ_HZ");
+
+    return isPassing ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,48 @@
+/**
+ * Checks that the onsets of the float analysis follow the clicks of the input, not its noise floor.
+ * The spectral flux must be computed on the FFT magnitudes, before the Mel filter bank raises them to its
+ * power in place, on |X|^4 the noise alone triggers many times more onsets than there are clicks.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+#include "AudioPipeline.h"
+#include "AubioDspProcessor.h"
+
+#define TEST_SECONDS 20u
+#define TEST_CLICK_INTERVAL_MS 500u
+
+int main() {
+    // Steady noise with a short tone burst every TEST_CLICK_INTERVAL_MS.
+    const size_t frames = TEST_SECONDS * SAMPLE_RATE;
+    const size_t interval = TEST_CLICK_INTERVAL_MS * SAMPLE_RATE / 1000u;
+    std::vector<float> audio(frames);
+    std::mt19937 random(1u);
+    std::normal_distribution<float> noise(0.0f, 0.02f);
+    for (size_t i = 0; i < frames; i++) {
+        audio[i] = noise(random);
+        const size_t sinceClick = i % interval;
+        if (sinceClick < 441u) {
+            audio[i] += 0.5f * std::sin(2.0f * static_cast<float>(M_PI) * 1000.0f * sinceClick / SAMPLE_RATE);
+        }
+    }
+    const size_t clicks = (frames + interval - 1u) / interval;
+
+    AubioDspProcessor processor(FFT_SIZE, HOP_SIZE, FILTER_SIZE, SAMPLE_RATE, MIN_FREQ_HZ, MAX_FREQ_HZ);
+    auto melBank = std::make_shared<ExpFilter>(0.0f, 0.5f, 0.5f, false, FILTER_SIZE);
+    size_t onsets = 0u;
+    for (size_t done = 0; done + HOP_SIZE <= frames; done += HOP_SIZE) {
+        processor.doMelBank(audio.data() + done, HOP_SIZE, melBank);
+        if (processor.getFeatures().isOnset) onsets++;
+    }
+
+    printf("%zu onsets for %zu clicks\n", onsets, clicks);
+    if (onsets < clicks * 8u / 10u || onsets > clicks * 12u / 10u) {
+        fprintf(stderr, "FAILED: the onsets don't follow the clicks\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,20 @@
+#ifndef LEDFX_TESTCHECK_H
+#define LEDFX_TESTCHECK_H
+
+#include <cstdio>
+
+/**
+ * Failure reporting shared by the host tests: check() prints every failed condition and the test returns
+ * EXIT_FAILURE at the end if isPassing was cleared, so one run reports all the failures.
+ */
+inline bool isPassing = true;
+
+inline void check(bool condition, const char* what) {
+    if (!condition) {
+        fprintf(stderr, "FAILED: %s\n", what);
+        isPassing = false;
+    }
+}
+
+
+#endif //LEDFX_TESTCHECK_H
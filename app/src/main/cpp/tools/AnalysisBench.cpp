@@ -0,0 +1,88 @@
+// Analysis benchmark: times the mono and the stereo analysis of the float DSP processors on the same
+// stereo noise, per hop, and prints the cost of the stereo analysis relative to the mono one.
+//
+// Usage: AnalysisBench [--seconds S] [--runs N]
+//   Analyses S seconds of audio (default 30) N times (default 5) with each processor and keeps the fastest run.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "AudioPipeline.h"
+#include "AubioDspProcessor.h"
+#include "StaticDspProcessor.h"
+
+struct BenchResult {
+    double monoUs;
+    double stereoUs;
+};
+
+/**
+ * Runs the mono analysis, then the stereo analysis, over the whole input with a new processor every run.
+ * @return the time per hop of the fastest run of each analysis.
+ */
+template<typename MakeProcessor>
+static BenchResult runBench(MakeProcessor makeProcessor, const std::vector<float>& audio, size_t runs) {
+    const size_t frames = audio.size() / 2u;
+    const double hops = static_cast<double>(frames / HOP_SIZE);
+    auto* data = const_cast<float*>(audio.data());
+    BenchResult best{1e12, 1e12};
+    for (size_t run = 0; run < runs; run++) {
+        std::unique_ptr<IDspProcessor> processor = makeProcessor();
+        auto melBank = std::make_shared<ExpFilter>(0.0f, 0.5f, 0.5f, false, FILTER_SIZE);
+        auto leftMelBank = std::make_shared<ExpFilter>(0.0f, 0.5f, 0.5f, false, FILTER_SIZE);
+        auto rightMelBank = std::make_shared<ExpFilter>(0.0f, 0.5f, 0.5f, false, FILTER_SIZE);
+
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t done = 0; done + HOP_SIZE <= frames; done += HOP_SIZE) {
+            processor->doMelBank(data + 2u * done, HOP_SIZE, melBank);
+        }
+        const auto mono = std::chrono::steady_clock::now();
+        for (size_t done = 0; done + HOP_SIZE <= frames; done += HOP_SIZE) {
+            processor->doStereoMelBank(data + 2u * done, HOP_SIZE, melBank, leftMelBank, rightMelBank);
+        }
+        const auto stereo = std::chrono::steady_clock::now();
+
+        best.monoUs = std::min(best.monoUs, std::chrono::duration<double, std::micro>(mono - start).count() / hops);
+        best.stereoUs = std::min(best.stereoUs, std::chrono::duration<double, std::micro>(stereo - mono).count() / hops);
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    double seconds = 30.0;
+    size_t runs = 5u;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if ("--seconds" == arg && hasValue) seconds = atof(argv[++i]);
+        else if ("--runs" == arg && hasValue) runs = static_cast<size_t>(atoi(argv[++i]));
+        else {
+            fprintf(stderr, "Usage: %s [--seconds S] [--runs N]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Independent noise on both channels, so neither analysis can take a shortcut.
+    std::vector<float> audio(2u * static_cast<size_t>(seconds * SAMPLE_RATE));
+    std::mt19937 random(1u);
+    std::normal_distribution<float> noise(0.0f, 0.1f);
+    for (float& sample : audio) sample = noise(random);
+
+    const BenchResult aubio = runBench([] {
+        return std::unique_ptr<IDspProcessor>(new AubioDspProcessor(FFT_SIZE, HOP_SIZE, FILTER_SIZE, SAMPLE_RATE,
+                                                                    MIN_FREQ_HZ, MAX_FREQ_HZ, 2u));
+    }, audio, runs);
+    const BenchResult preset = runBench([] {
+        return makeStaticDspProcessor(FFT_SIZE, HOP_SIZE, FILTER_SIZE, SAMPLE_RATE, MIN_FREQ_HZ, MAX_FREQ_HZ, 2u);
+    }, audio, runs);
+
+    printf("processor             mono us/hop  stereo us/hop  stereo/mono\n");
+    printf("AubioDspProcessor     %11.2f  %13.2f  %10.2fx\n", aubio.monoUs, aubio.stereoUs, aubio.stereoUs / aubio.monoUs);
+    printf("StaticDspProcessor    %11.2f  %13.2f  %10.2fx\n", preset.monoUs, preset.stereoUs, preset.stereoUs / preset.monoUs);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,41 @@
+// Frame log replay: sends a recorded or pre-rendered frame log (see FrameLog.h) to a WLED device
+// with its original timing, the same way the app replays it.
+//
+// Usage: FrameLogReplay <log> <ip> <port> [--loop]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include "FrameLog.h"
+#include "FrameLogPlayer.h"
+
+int main(int argc, char** argv) {
+    if (argc < 4) {
+        fprintf(stderr, "Usage: %s <log> <ip> <port> [--loop]\n", argv[0]);
+        return 1;
+    }
+    const bool isLooping = argc > 4 && 0 == strcmp(argv[4], "--loop");
+
+    FrameLogReader reader;
+    if (!reader.open(argv[1])) {
+        fprintf(stderr, "Failed to open %s\n", argv[1]);
+        return 1;
+    }
+    const size_t numLeds = reader.getFrameBytes() / 3u;
+    printf("%s: %llu frames of %zu LEDs, %.2f s\n", argv[1], static_cast<unsigned long long>(reader.getFrameCount()),
+           numLeds, reader.getDurationUs() / 1e6);
+    reader.close();
+
+    auto device = std::make_shared<WLedDevice>();
+    device->updateConfig(argv[2], static_cast<uint16_t>(atoi(argv[3])), numLeds);
+
+    FrameLogPlayer player;
+    if (!player.start(argv[1], device, isLooping)) return 1;
+    while (player.isPlaying()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    player.stop();
+    return 0;
+}
@@ -0,0 +1,282 @@
+// Offline renderer: runs a WAV or raw PCM file through the same AudioPipeline as the engine,
+// as fast as the CPU allows, and writes the rendered LED frames to a file.
+//
+// Usage: OfflineRenderer <input> <output> [options]
+//   --raw-s16 | --raw-f32   Input is headerless interleaved PCM instead of WAV.
+//   --channels N            Channel count of raw input (1 or 2, default 2).
+//   --rate HZ               Sample rate of raw input (default 44100).
+//   --leds N                Number of LEDs to render (default 60).
+//   --block FRAMES          Frames per processed buffer, like an audio callback (default HOP_SIZE).
+//   --stereo                Analyse the left and right channels separately.
+//   --fixed-point           Use the fixed point analysis on int16 samples.
+//   --multi-res             Use the multi-resolution float analysis, long FFT for the bass and short FFT for the highs.
+//   --log-bands N           Render a log-frequency spectrum of N bands instead of the Mel bands (16 to 512,
+//                           capped to the FFT bins in range, 184 at 44.1 kHz).
+//   --frame-log             Write a frame log (see FrameLog.h) instead of raw frames.
+//
+// The raw output holds one frame of numLeds * 3 RGB bytes per processed buffer, so frames are evenly spaced
+// at rate / block per second. Buffers that aren't sent (silence, reduced frame rate) repeat the previous frame.
+// The frame log only holds the sent frames, timestamped like the engine records them, ready for replay.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "AudioPipeline.h"
+#include "FrameLog.h"
+
+namespace {
+
+struct PcmData {
+    uint32_t sampleRate = SAMPLE_RATE;
+    uint32_t channelCount = 2u;
+    bool isFloat = false;
+    std::vector<int16_t> s16;  // Interleaved, used when !isFloat.
+    std::vector<float> f32;    // Interleaved, used when isFloat.
+
+    size_t frameCount() const { return (isFloat ? f32.size() : s16.size()) / channelCount; }
+};
+
+bool readFile(const char* path, std::vector<uint8_t>& bytes) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return false;
+    uint8_t chunk[65536];
+    size_t count;
+    while ((count = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        bytes.insert(bytes.end(), chunk, chunk + count);
+    }
+    fclose(file);
+    return true;
+}
+
+uint32_t readLe32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24); }
+uint16_t readLe16(const uint8_t* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+
+void setSamples(PcmData& pcm, const uint8_t* data, size_t numBytes) {
+    if (pcm.isFloat) {
+        pcm.f32.resize(numBytes / sizeof(float));
+        memcpy(pcm.f32.data(), data, pcm.f32.size() * sizeof(float));
+    } else {
+        pcm.s16.resize(numBytes / sizeof(int16_t));
+        memcpy(pcm.s16.data(), data, pcm.s16.size() * sizeof(int16_t));
+    }
+}
+
+/**
+ * Parses a 16 bit integer or 32 bit float WAV file, mono or stereo.
+ */
+bool parseWav(const std::vector<uint8_t>& bytes, PcmData& pcm) {
+    if (bytes.size() < 12 || memcmp(bytes.data(), "RIFF", 4) != 0 || memcmp(bytes.data() + 8, "WAVE", 4) != 0) {
+        fprintf(stderr, "Not a WAV file\n");
+        return false;
+    }
+
+    bool hasFormat = false;
+    size_t pos = 12;
+    while (pos + 8 <= bytes.size()) {
+        const uint8_t* chunk = bytes.data() + pos;
+        const size_t size = std::min<size_t>(readLe32(chunk + 4), bytes.size() - pos - 8);
+        if (0 == memcmp(chunk, "fmt ", 4) && size >= 16) {
+            uint16_t format = readLe16(chunk + 8);
+            if (0xFFFE == format && size >= 26) format = readLe16(chunk + 8 + 24);  // WAVE_FORMAT_EXTENSIBLE sub format.
+            pcm.channelCount = readLe16(chunk + 10);
+            pcm.sampleRate = readLe32(chunk + 12);
+            const uint16_t bits = readLe16(chunk + 22);
+            if (1 == format && 16 == bits) {
+                pcm.isFloat = false;
+            } else if (3 == format && 32 == bits) {
+                pcm.isFloat = true;
+            } else {
+                fprintf(stderr, "Unsupported WAV format %u with %u bits, use 16 bit PCM or 32 bit float\n", format, bits);
+                return false;
+            }
+            hasFormat = true;
+        } else if (0 == memcmp(chunk, "data", 4)) {
+            if (!hasFormat) break;
+            setSamples(pcm, chunk + 8, size);
+            return true;
+        }
+        pos += 8 + size + (size & 1u);
+    }
+    fprintf(stderr, "WAV file without fmt or data chunk\n");
+    return false;
+}
+
+/**
+ * Converts the samples to the format the selected analysis expects, int16 for fixed point and float otherwise.
+ */
+void convertSamples(PcmData& pcm, bool isFixedPoint) {
+    if (isFixedPoint && pcm.isFloat) {
+        pcm.s16.resize(pcm.f32.size());
+        for (size_t i = 0; i < pcm.f32.size(); i++) {
+            const float value = std::max(-1.0f, std::min(pcm.f32[i], 1.0f)) * 32768.0f;
+            pcm.s16[i] = static_cast<int16_t>(std::max(-32768.0f, std::min(value, 32767.0f)));
+        }
+        pcm.f32.clear();
+        pcm.isFloat = false;
+    } else if (!isFixedPoint && !pcm.isFloat) {
+        pcm.f32.resize(pcm.s16.size());
+        for (size_t i = 0; i < pcm.s16.size(); i++) {
+            pcm.f32[i] = static_cast<float>(pcm.s16[i]) / 32768.0f;
+        }
+        pcm.s16.clear();
+        pcm.isFloat = true;
+    }
+}
+
+void printUsage(const char* name) {
+    fprintf(stderr, "Usage: %s <input.wav|input.raw> <output.rgb> [--raw-s16|--raw-f32] [--channels N] [--rate HZ]\n"
+                    "       [--leds N] [--block FRAMES] [--stereo] [--fixed-point] [--multi-res] [--log-bands N] [--frame-log]\n", name);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    const char* inputPath = argv[1];
+    const char* outputPath = argv[2];
+    enum class Input { Wav, RawS16, RawF32 } input = Input::Wav;
+    uint32_t channelCount = 2u;
+    uint32_t sampleRate = SAMPLE_RATE;
+    size_t numLeds = 60u;
+    size_t blockFrames = HOP_SIZE;
+    bool isStereo = false;
+    bool isFixedPoint = false;
+    bool isMultiResolution = false;
+    size_t logBands = 0u;
+    bool isFrameLog = false;
+
+    for (int i = 3; i < argc; i++) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if ("--raw-s16" == arg) input = Input::RawS16;
+        else if ("--raw-f32" == arg) input = Input::RawF32;
+        else if ("--channels" == arg && hasValue) channelCount = static_cast<uint32_t>(atoi(argv[++i]));
+        else if ("--rate" == arg && hasValue) sampleRate = static_cast<uint32_t>(atoi(argv[++i]));
+        else if ("--leds" == arg && hasValue) numLeds = static_cast<size_t>(atoi(argv[++i]));
+        else if ("--block" == arg && hasValue) blockFrames = static_cast<size_t>(atoi(argv[++i]));
+        else if ("--stereo" == arg) isStereo = true;
+        else if ("--fixed-point" == arg) isFixedPoint = true;
+        else if ("--multi-res" == arg) isMultiResolution = true;
+        else if ("--log-bands" == arg && hasValue) logBands = static_cast<size_t>(atoi(argv[++i]));
+        else if ("--frame-log" == arg) isFrameLog = true;
+        else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<uint8_t> bytes;
+    if (!readFile(inputPath, bytes)) {
+        fprintf(stderr, "Failed to read %s\n", inputPath);
+        return 1;
+    }
+
+    PcmData pcm;
+    if (Input::Wav == input) {
+        if (!parseWav(bytes, pcm)) return 1;
+    } else {
+        pcm.channelCount = channelCount;
+        pcm.sampleRate = sampleRate;
+        pcm.isFloat = Input::RawF32 == input;
+        setSamples(pcm, bytes.data(), bytes.size());
+    }
+    bytes.clear();
+    bytes.shrink_to_fit();
+
+    if (pcm.channelCount < 1u || pcm.channelCount > 2u || 0u == pcm.sampleRate || 0u == blockFrames || 0u == numLeds) {
+        fprintf(stderr, "Unsupported configuration: %u channels, %u Hz, %zu frames per block, %zu LEDs\n",
+                pcm.channelCount, pcm.sampleRate, blockFrames, numLeds);
+        return 1;
+    }
+    convertSamples(pcm, isFixedPoint);
+
+    AudioPipeline pipeline(static_cast<int32_t>(pcm.sampleRate), pcm.channelCount, numLeds);
+    pipeline.setFixedPointAnalysis(isFixedPoint);
+    pipeline.setMultiResolutionAnalysis(isMultiResolution);
+    pipeline.setStereoAnalysis(isStereo);
+    pipeline.setLogSpectrumBands(logBands);
+    pipeline.reset();
+
+    const size_t frameCount = pcm.frameCount();
+    const size_t frameBytes = numLeds * BYTES_PER_LED;
+    const size_t outputFrames = (frameCount + blockFrames - 1u) / blockFrames;
+    std::vector<uint8_t> output;
+    FrameLogWriter frameLog;
+    if (isFrameLog) {
+        if (!frameLog.open(outputPath, frameBytes)) {
+            fprintf(stderr, "Failed to create %s\n", outputPath);
+            return 1;
+        }
+    } else {
+        output.reserve(outputFrames * frameBytes);
+    }
+
+    // Only the pipeline is timed, file IO and sample conversion are left out of the realtime factor.
+    // The frame log is written through a memory mapping, its encoding is timed like the engine's recording.
+    size_t sentFrames = 0u;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t frame = 0; frame < frameCount; frame += blockFrames) {
+        const size_t count = std::min(blockFrames, frameCount - frame);
+        void* audioData = pcm.isFloat ? static_cast<void*>(pcm.f32.data() + frame * pcm.channelCount)
+                                      : static_cast<void*>(pcm.s16.data() + frame * pcm.channelCount);
+        const bool isSent = pipeline.process(audioData, static_cast<int32_t>(count), false);
+        const std::vector<uint8_t>& ledData = pipeline.getLedData();
+        if (isSent) {
+            sentFrames++;
+            if (isFrameLog) {
+                frameLog.append(ledData.data(), frameBytes, static_cast<uint64_t>(frame) * 1000000u / pcm.sampleRate);
+            }
+        }
+        if (!isFrameLog) {
+            output.insert(output.end(), ledData.begin(), ledData.end());
+        }
+    }
+    const double elapsedSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (isFrameLog) {
+        const size_t logBytes = frameLog.getSize();
+        if (!frameLog.close()) {
+            fprintf(stderr, "Failed to write %s\n", outputPath);
+            return 1;
+        }
+        printf("frame log: %zu bytes, %.1f%% of raw frames\n", logBytes,
+               100.0 * static_cast<double>(logBytes) / static_cast<double>(std::max<size_t>(sentFrames * frameBytes, 1u)));
+    } else {
+        FILE* file = fopen(outputPath, "wb");
+        if (!file || fwrite(output.data(), 1, output.size(), file) != output.size()) {
+            fprintf(stderr, "Failed to write %s\n", outputPath);
+            if (file) fclose(file);
+            return 1;
+        }
+        fclose(file);
+    }
+
+    // FNV-1a of the raw output, so renders can be compared without keeping reference files around.
+    uint64_t hash = 1469598103934665603ull;
+    for (const uint8_t byte : output) {
+        hash = (hash ^ byte) * 1099511628211ull;
+    }
+
+    const double audioSec = static_cast<double>(frameCount) / pcm.sampleRate;
+    printf("input: %.2f s, %u Hz, %u channels, %s analysis%s\n", audioSec, pcm.sampleRate, pcm.channelCount,
+           isFixedPoint ? "fixed point" : isMultiResolution ? "multi-resolution float" : "float",
+           isStereo ? ", stereo" : "");
+    if (0u != pipeline.getLogSpectrumBands()) {
+        printf("log spectrum: %zu bands\n", pipeline.getLogSpectrumBands());
+    }
+    printf("frames: %zu (%zu sent) of %zu LEDs at %.2f fps\n", outputFrames, sentFrames, numLeds,
+           static_cast<double>(pcm.sampleRate) / blockFrames);
+    printf("processing: %.3f s, realtime factor: %.1fx\n", elapsedSec, elapsedSec > 0.0 ? audioSec / elapsedSec : 0.0);
+    if (!isFrameLog) {
+        printf("checksum: %016llx\n", static_cast<unsigned long long>(hash));
+    }
+    return 0;
+}
@@ -0,0 +1,189 @@
+// Output benchmark: drives several WLedDevice instances at a fixed frame rate with a moving test pattern,
+// and reports the achieved frame rate and the time spent rendering, encoding and sending. Run WledReceiver
+// on the same ports to measure what arrives.
+//
+// Usage: OutputBench [--devices N] [--leds N] [--fps F] [--seconds S] [--protocol drgb|dnrgb|ddp]
+//                    [--host IP] [--port BASE] [--workers N] [--sweep] [--fifo P] [--nice N] [--big-cores]
+//   Device i sends to port BASE + i (default host 127.0.0.1, base 21324, 1 device of 60 LEDs at 60 fps for 10 s).
+//   --workers N  Render and encode the devices on a RenderPool of N threads besides the main one, then send
+//                them in parallel after the frame barrier (default 0, everything on the main thread).
+//   --sweep      Runs 1, 2, 4, 8 and 16 devices, each without and with the workers, and prints the scaling.
+//   --fifo P, --nice N, --big-cores
+//                Scheduling of the benchmark and worker threads, as in the app: SCHED_FIFO priority P if allowed,
+//                else nice level N, optionally kept off the slowest cores. Reports the applied policy and the
+//                wakeup latency of the workers.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "RenderPool.h"
+#include "WLedDevice.h"
+
+struct BenchResult {
+    double fps;
+    double frameUsMean;
+    double frameUsMax;
+    size_t failures;
+    ThreadScheduling::Policy workerPolicy;
+    double wakeupUsMean;
+    double wakeupUsMax;
+};
+
+static const char* policyName(ThreadScheduling::Policy policy) {
+    switch (policy) {
+        case ThreadScheduling::Policy::Fifo: return "SCHED_FIFO";
+        case ThreadScheduling::Policy::Nice: return "nice";
+        default: return "default";
+    }
+}
+
+/**
+ * Streams the test pattern to deviceCount devices on consecutive ports.
+ * @return the achieved rate and the time per frame for all devices, or a negative rate if a socket failed.
+ */
+static BenchResult runBench(size_t deviceCount, size_t numLeds, double fps, double seconds, WLedDevice::Protocol protocol,
+                            const std::string& host, int basePort, size_t workerCount, const ThreadScheduling& scheduling) {
+    std::vector<std::shared_ptr<WLedDevice>> devices;
+    std::vector<std::vector<uint8_t>> ledData(deviceCount, std::vector<uint8_t>(numLeds * 3u, 0u));
+    std::vector<uint8_t> isEncoded(deviceCount, 0u);
+    for (size_t i = 0; i < deviceCount; i++) {
+        auto device = std::make_shared<WLedDevice>();
+        device->updateConfig(host, static_cast<uint16_t>(basePort + i), numLeds);
+        device->setProtocol(protocol);
+        if (!device->activate()) return {-1.0, 0.0, 0.0, 0u, ThreadScheduling::Policy::Default, 0.0, 0.0};
+        devices.push_back(device);
+    }
+    RenderPool pool(workerCount);
+    pool.setScheduling(scheduling);
+
+    const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / fps));
+    const size_t frameCount = static_cast<size_t>(seconds * fps);
+    std::atomic<size_t> failures{0u};
+    double frameNsTotal = 0.0, frameNsMax = 0.0;
+    size_t frame = 0u;
+
+    // A single lit pixel moving along the strip, so every frame differs.
+    auto render = [&](size_t d) {
+        std::vector<uint8_t>& data = ledData[d];
+        std::fill(data.begin(), data.end(), 0u);
+        const size_t lit = ((frame + d) % numLeds) * 3u;
+        data[lit] = 255u;
+        data[lit + 1u] = static_cast<uint8_t>(frame);
+        data[lit + 2u] = static_cast<uint8_t>(d);
+        const WLedDevice::Config* config = devices[d]->acquireConfig();
+        isEncoded[d] = config && devices[d]->encode(*config, data.data(), data.size());
+    };
+    auto send = [&](size_t d) {
+        if (!isEncoded[d] || !devices[d]->send()) failures.fetch_add(1u, std::memory_order_relaxed);
+    };
+
+    const auto start = std::chrono::steady_clock::now();
+    for (frame = 0; frame < frameCount; frame++) {
+        std::this_thread::sleep_until(start + period * frame);
+
+        const auto frameStart = std::chrono::steady_clock::now();
+        pool.run(deviceCount, render);
+        // Frame barrier, every device is encoded before the first packet goes out.
+        pool.run(deviceCount, send);
+        const double frameNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - frameStart).count();
+        frameNsTotal += frameNs;
+        frameNsMax = std::max(frameNsMax, frameNs);
+    }
+    const double elapsedSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (auto& device : devices) device->deactivate();
+
+    return {elapsedSec > 0.0 ? frameCount / elapsedSec : 0.0, frameCount ? frameNsTotal / frameCount / 1000.0 : 0.0,
+            frameNsMax / 1000.0, failures.load(), pool.getPolicy(), pool.getWakeupLatency().getMeanNs() / 1000.0,
+            pool.getWakeupLatency().getMaxNs() / 1000.0};
+}
+
+int main(int argc, char** argv) {
+    size_t deviceCount = 1u;
+    size_t numLeds = 60u;
+    double fps = 60.0;
+    double seconds = 10.0;
+    std::string host = "127.0.0.1";
+    int basePort = 21324;
+    WLedDevice::Protocol protocol = WLedDevice::Protocol::Drgb;
+    size_t workerCount = 0u;
+    bool isSweep = false;
+    ThreadScheduling scheduling;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if ("--devices" == arg && hasValue) deviceCount = static_cast<size_t>(atoi(argv[++i]));
+        else if ("--leds" == arg && hasValue) numLeds = static_cast<size_t>(atoi(argv[++i]));
+        else if ("--fps" == arg && hasValue) fps = atof(argv[++i]);
+        else if ("--seconds" == arg && hasValue) seconds = atof(argv[++i]);
+        else if ("--host" == arg && hasValue) host = argv[++i];
+        else if ("--port" == arg && hasValue) basePort = atoi(argv[++i]);
+        else if ("--workers" == arg && hasValue) workerCount = static_cast<size_t>(atoi(argv[++i]));
+        else if ("--sweep" == arg) isSweep = true;
+        else if ("--fifo" == arg && hasValue) scheduling.fifoPriority = atoi(argv[++i]);
+        else if ("--nice" == arg && hasValue) scheduling.niceLevel = atoi(argv[++i]);
+        else if ("--big-cores" == arg) scheduling.cpuMask = ThreadScheduling::getBigCoreMask();
+        else if ("--protocol" == arg && hasValue) {
+            const std::string name = argv[++i];
+            if ("drgb" == name) protocol = WLedDevice::Protocol::Drgb;
+            else if ("dnrgb" == name) protocol = WLedDevice::Protocol::Dnrgb;
+            else if ("ddp" == name) protocol = WLedDevice::Protocol::Ddp;
+            else {
+                fprintf(stderr, "Unknown protocol %s\n", name.c_str());
+                return 1;
+            }
+        } else {
+            fprintf(stderr, "Usage: %s [--devices N] [--leds N] [--fps F] [--seconds S] [--protocol drgb|dnrgb|ddp]"
+                            " [--host IP] [--port BASE] [--workers N] [--sweep] [--fifo P] [--nice N] [--big-cores]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (0u == deviceCount || 0u == numLeds || fps <= 0.0) return 1;
+
+    // The main thread is the pool's calling thread, it gets the same scheduling as the workers.
+    const ThreadScheduling::Policy mainPolicy = scheduling.apply();
+    // getBigCoreMask() returns 0 when all the cores are alike, the threads then run on any CPU.
+    if (0u == scheduling.cpuMask) {
+        printf("main thread: %s, all CPUs\n", policyName(mainPolicy));
+    } else {
+        printf("main thread: %s, CPU mask 0x%llx\n", policyName(mainPolicy), static_cast<unsigned long long>(scheduling.cpuMask));
+    }
+
+    if (isSweep) {
+        // The pooled runs use the given worker count, or one worker per remaining core.
+        const size_t coreCount = std::thread::hardware_concurrency();
+        const size_t pooledWorkers = workerCount ? workerCount : (coreCount > 1u ? coreCount - 1u : 1u);
+        printf("devices | serial: frame us mean / max, fps | %zu workers: frame us mean / max, fps | speedup\n", pooledWorkers);
+        for (size_t devices = 1u; devices <= 16u; devices *= 2u) {
+            const BenchResult serial = runBench(devices, numLeds, fps, seconds, protocol, host, basePort, 0u, scheduling);
+            const BenchResult pooled = runBench(devices, numLeds, fps, seconds, protocol, host, basePort, pooledWorkers,
+                                                scheduling);
+            if (serial.fps < 0.0 || pooled.fps < 0.0) return 1;
+            printf("%7zu | %8.1f / %8.1f, %6.2f | %8.1f / %8.1f, %6.2f | %.2fx%s\n", devices, serial.frameUsMean,
+                   serial.frameUsMax, serial.fps, pooled.frameUsMean, pooled.frameUsMax, pooled.fps,
+                   pooled.frameUsMean > 0.0 ? serial.frameUsMean / pooled.frameUsMean : 0.0,
+                   serial.failures || pooled.failures ? " (failed flushes)" : "");
+        }
+        return 0;
+    }
+
+    const BenchResult result = runBench(deviceCount, numLeds, fps, seconds, protocol, host, basePort, workerCount,
+                                        scheduling);
+    if (result.fps < 0.0) return 1;
+    printf("%zu device(s) of %zu LEDs, %zu frames at %.2f fps, %zu failed flushes\n", deviceCount, numLeds,
+           static_cast<size_t>(seconds * fps), result.fps, result.failures);
+    printf("render, encode and send time per frame (all devices, %zu workers): mean %.1f us, max %.1f us\n",
+           workerCount, result.frameUsMean, result.frameUsMax);
+    if (0u != workerCount) {
+        printf("workers: %s, wakeup latency mean %.1f us, max %.1f us\n", policyName(result.workerPolicy),
+               result.wakeupUsMean, result.wakeupUsMax);
+    }
+    return 0;
+}
@@ -0,0 +1,255 @@
+// WLED receiver simulator: listens on one UDP port per simulated device, decodes DRGB, DNRGB and DDP packets
+// and reports per device frame rate, inter-frame jitter, packet loss, reordering and torn frames.
+//
+// Usage: WledReceiver [--port P]... [--ports BASE COUNT] [--leds N] [--seconds S]
+//   --port P            Listen on port P, can be repeated (default 21324).
+//   --ports BASE COUNT  Listen on COUNT consecutive ports starting at BASE.
+//   --leds N            Expected LED count per frame, learned from the traffic when not given.
+//                       DNRGB frames then only count once a whole frame was seen, from the first wrap to LED 0.
+//   --seconds S         Stop after S seconds (default: run until interrupted).
+//
+// A frame is complete when a DRGB packet arrives, when DNRGB packets cover the whole strip,
+// or when a DDP packet with the push flag closes a gap free frame. A frame that gets interrupted
+// by the start of the next one, or that is pushed with missing data, counts as torn.
+// Loss and reordering come from the DDP sequence numbers and from the DNRGB start indexes.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::atomic<bool> gShouldStop{false};
+
+struct Device {
+    uint16_t port = 0u;
+    int fd = -1;
+    uint64_t packets = 0u;
+    uint64_t bytes = 0u;
+    uint64_t frames = 0u;
+    uint64_t tornFrames = 0u;
+    uint64_t lostPackets = 0u;
+    uint64_t reorderedPackets = 0u;
+    uint64_t unknownPackets = 0u;
+    const char* protocol = "-";
+    std::vector<double> frameTimesMs;
+
+    // Frame being assembled from DNRGB or DDP packets.
+    bool inFrame = false;
+    bool hasGap = false;
+    size_t nextOffset = 0u;     // Expected LED index (DNRGB) or byte offset (DDP) of the next packet.
+    size_t maxLeds = 0u;        // Largest LED count seen, used when --leds isn't given.
+    bool isDnrgbLengthKnown = false;  // A DNRGB frame wrapped to LED 0, so maxLeds covers the whole strip.
+    uint8_t lastSequence = 0u;
+};
+
+void completeFrame(Device& device, double timeMs, bool isTorn) {
+    if (isTorn) {
+        device.tornFrames++;
+    } else {
+        device.frames++;
+        device.frameTimesMs.push_back(timeMs);
+    }
+    device.inFrame = false;
+    device.hasGap = false;
+    device.nextOffset = 0u;
+}
+
+void onDnrgb(Device& device, const uint8_t* packet, size_t numBytes, size_t expectedLeds, double timeMs) {
+    const size_t start = (packet[2] << 8) | packet[3];
+    const size_t count = (numBytes - 4u) / 3u;
+    device.maxLeds = std::max(device.maxLeds, start + count);
+    const size_t frameLeds = expectedLeds ? expectedLeds : device.maxLeds;
+    // A strip split across packets looks complete after its first packet until a frame wraps to LED 0.
+    const bool isLengthKnown = 0u != expectedLeds || device.isDnrgbLengthKnown;
+
+    if (0u == start && device.inFrame) {
+        if (isLengthKnown) {
+            // The previous frame never got its last packets.
+            completeFrame(device, timeMs, true);
+        } else {
+            // The frame the length was learned from isn't counted, its end wasn't known while it arrived.
+            device.isDnrgbLengthKnown = true;
+            device.hasGap = false;
+        }
+    } else if (start < device.nextOffset) {
+        device.reorderedPackets++;
+        return;
+    } else if (start > device.nextOffset) {
+        device.lostPackets++;
+        device.hasGap = true;
+    }
+
+    device.inFrame = true;
+    device.nextOffset = start + count;
+    if (device.nextOffset >= frameLeds && (0u != expectedLeds || device.isDnrgbLengthKnown)) {
+        completeFrame(device, timeMs, device.hasGap);
+    }
+}
+
+void onDdp(Device& device, const uint8_t* packet, size_t numBytes, size_t expectedLeds, double timeMs) {
+    const uint8_t sequence = packet[1] & 0x0Fu;
+    if (0u != sequence && 0u != device.lastSequence) {
+        const uint8_t expected = static_cast<uint8_t>(device.lastSequence % 15u + 1u);
+        const int ahead = (sequence - expected + 15) % 15;
+        if (ahead > 0 && ahead < 8) {
+            device.lostPackets += ahead;
+        } else if (ahead >= 8) {
+            // A sequence number from the past, keep expecting the newest one.
+            device.reorderedPackets++;
+            return;
+        }
+    }
+    if (0u != sequence) device.lastSequence = sequence;
+
+    const size_t offset = (static_cast<size_t>(packet[4]) << 24) | (packet[5] << 16) | (packet[6] << 8) | packet[7];
+    const size_t length = std::min<size_t>((packet[8] << 8) | packet[9], numBytes - 10u);
+    device.maxLeds = std::max(device.maxLeds, (offset + length) / 3u);
+
+    if (0u == offset && device.inFrame) {
+        completeFrame(device, timeMs, true);
+    }
+    if (offset != device.nextOffset) device.hasGap = true;
+    device.inFrame = true;
+    device.nextOffset = offset + length;
+
+    if (packet[0] & 0x01u) {
+        const size_t frameBytes = (expectedLeds ? expectedLeds : device.maxLeds) * 3u;
+        completeFrame(device, timeMs, device.hasGap || device.nextOffset < frameBytes);
+    }
+}
+
+void onPacket(Device& device, const uint8_t* packet, size_t numBytes, size_t expectedLeds, double timeMs) {
+    device.packets++;
+    device.bytes += numBytes;
+
+    if (numBytes >= 10u && 0x40u == (packet[0] & 0xC0u)) {
+        device.protocol = "DDP";
+        onDdp(device, packet, numBytes, expectedLeds, timeMs);
+    } else if (numBytes >= 2u && 2u == packet[0]) {
+        device.protocol = "DRGB";
+        const size_t leds = (numBytes - 2u) / 3u;
+        device.maxLeds = std::max(device.maxLeds, leds);
+        completeFrame(device, timeMs, 0u != expectedLeds && leds != expectedLeds);
+    } else if (numBytes >= 4u && 4u == packet[0]) {
+        device.protocol = "DNRGB";
+        onDnrgb(device, packet, numBytes, expectedLeds, timeMs);
+    } else {
+        device.unknownPackets++;
+    }
+}
+
+void report(const Device& device) {
+    const std::vector<double>& times = device.frameTimesMs;
+    double fps = 0.0, meanMs = 0.0, stdMs = 0.0, p99Ms = 0.0, maxMs = 0.0;
+    if (times.size() > 1u) {
+        std::vector<double> intervals(times.size() - 1u);
+        for (size_t i = 1; i < times.size(); i++) intervals[i - 1u] = times[i] - times[i - 1u];
+        meanMs = (times.back() - times.front()) / static_cast<double>(intervals.size());
+        fps = meanMs > 0.0 ? 1000.0 / meanMs : 0.0;
+
+        // Jitter as the deviation of the inter-frame intervals from their mean.
+        std::vector<double> deviations(intervals.size());
+        double sum = 0.0;
+        for (size_t i = 0; i < intervals.size(); i++) {
+            deviations[i] = std::fabs(intervals[i] - meanMs);
+            sum += (intervals[i] - meanMs) * (intervals[i] - meanMs);
+        }
+        stdMs = std::sqrt(sum / static_cast<double>(intervals.size()));
+        std::sort(deviations.begin(), deviations.end());
+        p99Ms = deviations[std::min(deviations.size() - 1u, deviations.size() * 99u / 100u)];
+        maxMs = deviations.back();
+    }
+
+    printf("port %u %-5s packets %llu (%.1f KiB) frames %llu torn %llu lost %llu reordered %llu unknown %llu | "
+           "%.2f fps, interval %.3f ms, jitter std %.3f ms p99 %.3f ms max %.3f ms\n",
+           device.port, device.protocol, static_cast<unsigned long long>(device.packets), device.bytes / 1024.0,
+           static_cast<unsigned long long>(device.frames), static_cast<unsigned long long>(device.tornFrames),
+           static_cast<unsigned long long>(device.lostPackets), static_cast<unsigned long long>(device.reorderedPackets),
+           static_cast<unsigned long long>(device.unknownPackets), fps, meanMs, stdMs, p99Ms, maxMs);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::vector<uint16_t> ports;
+    size_t expectedLeds = 0u;
+    double seconds = 0.0;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if ("--port" == arg && i + 1 < argc) {
+            ports.push_back(static_cast<uint16_t>(atoi(argv[++i])));
+        } else if ("--ports" == arg && i + 2 < argc) {
+            const int base = atoi(argv[++i]);
+            const int count = atoi(argv[++i]);
+            for (int p = 0; p < count; p++) ports.push_back(static_cast<uint16_t>(base + p));
+        } else if ("--leds" == arg && i + 1 < argc) {
+            expectedLeds = static_cast<size_t>(atoi(argv[++i]));
+        } else if ("--seconds" == arg && i + 1 < argc) {
+            seconds = atof(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [--port P]... [--ports BASE COUNT] [--leds N] [--seconds S]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (ports.empty()) ports.push_back(21324u);
+
+    std::vector<Device> devices(ports.size());
+    std::vector<pollfd> fds(ports.size());
+    for (size_t i = 0; i < ports.size(); i++) {
+        Device& device = devices[i];
+        device.port = ports[i];
+        device.fd = socket(AF_INET, SOCK_DGRAM, 0);
+        const int bufferBytes = 4 << 20;
+        setsockopt(device.fd, SOL_SOCKET, SO_RCVBUF, &bufferBytes, sizeof(bufferBytes));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(device.port);
+        if (device.fd < 0 || 0 != bind(device.fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr))) {
+            fprintf(stderr, "Failed to listen on port %u\n", device.port);
+            return 1;
+        }
+        fds[i] = {device.fd, POLLIN, 0};
+    }
+    signal(SIGINT, [](int) { gShouldStop = true; });
+    fprintf(stderr, "Listening on %zu port(s), interrupt to stop\n", ports.size());
+
+    const auto start = Clock::now();
+    std::vector<uint8_t> packet(65536);
+    while (!gShouldStop) {
+        const double elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        if (seconds > 0.0 && elapsedMs >= seconds * 1000.0) break;
+        if (poll(fds.data(), fds.size(), 100) <= 0) continue;
+
+        for (size_t i = 0; i < fds.size(); i++) {
+            if (!(fds[i].revents & POLLIN)) continue;
+            ssize_t numBytes;
+            while ((numBytes = recv(fds[i].fd, packet.data(), packet.size(), MSG_DONTWAIT)) > 0) {
+                const double timeMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+                onPacket(devices[i], packet.data(), static_cast<size_t>(numBytes), expectedLeds, timeMs);
+            }
+        }
+    }
+
+    for (Device& device : devices) {
+        // A frame still being assembled when the capture stops is not counted.
+        report(device);
+        close(device.fd);
+    }
+    return 0;
+}
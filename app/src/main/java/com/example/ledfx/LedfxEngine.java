@@ -5,12 +5,15 @@ import android.media.AudioManager;
 import android.os.Build;
 
 /**
- * Singleton class for interacting with the LED effects engine.
+ * Native methods for interacting with the LED effects engines.
  * This class interfaces with the native "ledfx-native" library to control LED effects based on audio input.
+ * Several engines can run at once, for example one per audio input, each one is referred to by the handle
+ * returned by {@link #create()}. All engines share one native thread sending the LED frames.
  */
-public enum LedfxEngine {
+public final class LedfxEngine {
 
-    INSTANCE;
+    private LedfxEngine() {
+    }
 
     // Load the native library for LED effects
     static {
@@ -19,55 +22,189 @@ public enum LedfxEngine {
 
     // Native methods for interacting with the LED effects engine
     /**
-     * Initializes the LED effects engine.
+     * Creates an LED effects engine, with its own audio input, analysis and LED device.
      *
-     * @return true if initialization was successful, false otherwise.
+     * @return the handle of the engine, to pass to the other methods until it is deleted.
      */
-    static native boolean create();
+    static native long create();
 
     /**
      * Checks if the AAudio API is recommended for audio processing.
      *
+     * @param engine The handle of the engine.
      * @return true if AAudio is recommended, false otherwise.
      */
-    static native boolean isAAudioRecommended();
+    static native boolean isAAudioRecommended(long engine);
 
     /**
-     * Sets the API type for audio processing.
+     * Sets the API type for audio processing. While the effect is on only the input stream is reopened,
+     * the analysis state and the LED output are kept.
      *
+     * @param engine The handle of the engine.
      * @param apiType The type of audio API to use (e.g., AAudio, OpenSL ES).
      * @return true if the API was set successfully, false otherwise.
      */
-    static native boolean setAPI(int apiType);
+    static native boolean setAPI(long engine, int apiType);
 
     /**
      * Turns the LED effect on or off.
      *
+     * @param engine The handle of the engine.
      * @param isEffectOn true to start the effect, false to stop it.
      * @return true if the effect was successfully turned on/off, false otherwise.
      */
-    static native boolean setEffectOn(boolean isEffectOn);
+    static native boolean setEffectOn(long engine, boolean isEffectOn);
 
     /**
      * Updates the LED configuration with the given parameters.
      *
+     * @param engine The handle of the engine.
      * @param iPAddr The IP address of the LED device.
      * @param portNum The port number to connect to.
      * @param numLeds The number of LEDs in the device.
      */
-    static native void updateConfig(String iPAddr, int portNum, long numLeds);
+    static native void updateConfig(long engine, String iPAddr, int portNum, long numLeds);
+
+    /**
+     * Selects stereo analysis, the left channel drives the first half of the strip and the right channel the second half.
+     *
+     * @param engine The handle of the engine.
+     * @param isStereo true to analyse both channels separately, false to analyse their mix.
+     */
+    static native void setStereoAnalysis(long engine, boolean isStereo);
+
+    /**
+     * Reads the state of the CPU budget governor, which lowers the analysis quality under load.
+     *
+     * @param engine The handle of the engine.
+     * @return {quality level (0 is full quality), number of level transitions, callback load in percent}.
+     */
+    static native int[] getQualityStats(long engine);
+
+    /**
+     * Reads the engine counters since the effect was turned on, all taken from the same audio callback.
+     *
+     * @param engine The handle of the engine.
+     * @return {audio callbacks, analysed hops, rendered frames, sent frames, dropped frames, failed packet sends,
+     * XRuns of the input stream, output frames per second times 100, 1 if the input is silent}.
+     */
+    static native long[] getEngineStats(long engine);
+
+    /**
+     * Selects the fixed point analysis, which captures 16 bit PCM and avoids floating point work on the audio thread.
+     * Must be called while the effect is off.
+     *
+     * @param engine The handle of the engine.
+     * @param isFixedPoint true for the fixed point analysis, false for the float one.
+     * @return true if the analysis was changed, false if the effect is on.
+     */
+    static native boolean setFixedPointAnalysis(long engine, boolean isFixedPoint);
+
+    /**
+     * Renders a log-frequency spectrum of many bands across the strip instead of the Mel bands,
+     * so long strips show more than a few stretched blocks. Must be called while the effect is off.
+     *
+     * @param engine The handle of the engine.
+     * @param bandCount The number of bands, 16 to 512, 0 to render the Mel bands. The count is capped to the FFT
+     *                  bins between 100 Hz and 16 kHz, 184 at 44.1 kHz and 169 at 48 kHz, more bands would only
+     *                  interpolate the same bins. The multi-resolution analysis resolves more bass bands from its
+     *                  long FFT, 216 at 44.1 kHz and 198 at 48 kHz.
+     * @return true if the rendering was changed, false if the effect is on.
+     */
+    static native boolean setLogSpectrumBands(long engine, int bandCount);
+
+    /**
+     * Selects the multi-resolution analysis: a long FFT at a reduced sample rate resolves the bass down to 50 Hz,
+     * a short FFT at the full rate follows the highs and detects onsets earlier. Only applies to the float analysis.
+     * Must be called while the effect is off.
+     *
+     * @param engine The handle of the engine.
+     * @param isMultiResolution true for the multi-resolution analysis, false for the single FFT one.
+     * @return true if the analysis was changed, false if the effect is on.
+     */
+    static native boolean setMultiResolutionAnalysis(long engine, boolean isMultiResolution);
+
+    /**
+     * Records the LED frames sent while the effect is on, the file is recreated every time the effect is turned on.
+     * Must be called while the effect is off.
+     *
+     * @param engine The handle of the engine.
+     * @param path The frame log file, empty to disable recording.
+     * @return true if the path was set, false if the effect is on.
+     */
+    static native boolean setFrameLogPath(long engine, String path);
+
+    /**
+     * Plays a recorded frame log to the LED device with its original timing, without capturing audio.
+     * Must be called while the effect is off, turning the effect on stops the replay.
+     *
+     * @param engine The handle of the engine.
+     * @param path The frame log file.
+     * @param isLooping true to restart at the end of the log.
+     * @return true if the replay started.
+     */
+    static native boolean startReplay(long engine, String path, boolean isLooping);
+
+    /**
+     * Stops the frame log replay.
+     *
+     * @param engine The handle of the engine.
+     */
+    static native void stopReplay(long engine);
+
+    /**
+     * Selects the protocol the LED frames are sent with. DRGB fits up to 490 LEDs in one packet,
+     * DNRGB and DDP split longer strips across packets. Must be called while the effect is off.
+     *
+     * @param engine The handle of the engine.
+     * @param protocol 0 for DRGB, 1 for DNRGB, 2 for DDP.
+     * @return true if the protocol was changed, false if the effect is on or the protocol is unknown.
+     */
+    static native boolean setOutputProtocol(long engine, int protocol);
 
     /**
-     * Sets the recording device ID for audio input.
+     * Sets the recording device ID for audio input. While the effect is on only the input stream is reopened,
+     * the analysis state and the LED output are kept.
      *
+     * @param engine The handle of the engine.
      * @param deviceId The ID of the audio recording device.
      */
-    static native void setRecordingDeviceId(int deviceId);
+    static native void setRecordingDeviceId(long engine, int deviceId);
 
     /**
-     * Cleans up and deletes the LED effects engine resources.
+     * Reads the timing of the input switches done by setAPI, setRecordingDeviceId and device disconnects.
+     *
+     * @param engine The handle of the engine.
+     * @return {number of switches, LED output pause of the last switch in microseconds}.
+     */
+    static native long[] getInputSwitchStats(long engine);
+
+    /**
+     * Sets the priority and CPU affinity of the native threads sending the LED frames, shared by all engines.
+     * SCHED_FIFO is tried first, the nice level is used when the system doesn't allow it. By default SCHED_FIFO
+     * priority 2 is tried, then nice -16, on any core.
+     *
+     * @param fifoPriority The SCHED_FIFO priority, 1 to 99, 0 to only use the nice level.
+     * @param niceLevel The nice level, -20 to 19.
+     * @param isBigCoresOnly true to keep the threads off the slowest cluster of a big.LITTLE SoC.
+     */
+    static native void setWorkerScheduling(int fifoPriority, int niceLevel, boolean isBigCoresOnly);
+
+    /**
+     * Reads the scheduling the native sending threads got, and how fast they wake up for a new frame.
+     *
+     * @return {policy of the sender thread, policy of the pool threads (0 default, 1 nice level, 2 SCHED_FIFO),
+     * mean and max wakeup latency of the sender thread in nanoseconds, mean and max wakeup latency of the pool
+     * threads in nanoseconds, CPU mask in use (0 for any CPU)}, all 0 while no engine exists.
+     */
+    static native long[] getWorkerSchedulingStats();
+
+    /**
+     * Turns the effect off and deletes the engine, its handle becomes invalid.
+     *
+     * @param engine The handle of the engine.
      */
-    static native void delete();
+    static native void delete(long engine);
 
     /**
      * Sets default stream values for audio input/output, such as sample rate and frames per burst.
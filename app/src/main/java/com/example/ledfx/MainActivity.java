@@ -42,6 +42,7 @@ public class MainActivity extends Activity
 
     private int apiSelection = OBOE_API_AAUDIO;
     private boolean mAAudioRecommended = true;
+    private long mEngine;  // Handle of the native engine, see LedfxEngine.create().
 
     /**
      * Initializes the MainActivity and sets up the UI components and initial configurations.
@@ -83,7 +84,7 @@ public class MainActivity extends Activity
             recordingDeviceSpinner.setOnItemSelectedListener(new AdapterView.OnItemSelectedListener() {
                 @Override
                 public void onItemSelected(AdapterView<?> adapterView, View view, int i, long l) {
-                    LedfxEngine.setRecordingDeviceId(getRecordingDeviceId());
+                    LedfxEngine.setRecordingDeviceId(mEngine, getRecordingDeviceId());
                 }
 
                 @Override
@@ -155,10 +156,10 @@ public class MainActivity extends Activity
      * Starts the necessary audio setup and configures the system to use the correct API.
      */
     private void onStartTest() {
-        LedfxEngine.create();
-        mAAudioRecommended = LedfxEngine.isAAudioRecommended();
+        mEngine = LedfxEngine.create();
+        mAAudioRecommended = LedfxEngine.isAAudioRecommended(mEngine);
         EnableAudioApiUI(true);
-        LedfxEngine.setAPI(apiSelection);
+        LedfxEngine.setAPI(mEngine, apiSelection);
     }
 
     /**
@@ -166,7 +167,7 @@ public class MainActivity extends Activity
      */
     private void onStopTest() {
         stopEffect();
-        LedfxEngine.delete();
+        LedfxEngine.delete(mEngine);
     }
 
     /**
@@ -176,7 +177,7 @@ public class MainActivity extends Activity
         if (isPlaying) {
             stopEffect();
         } else {
-            LedfxEngine.setAPI(apiSelection);
+            LedfxEngine.setAPI(mEngine, apiSelection);
             startEffect();
         }
     }
@@ -199,8 +200,8 @@ public class MainActivity extends Activity
         long numLeds = Long.parseLong(binding.numLedsInput.getText().toString());
 
         // Update LED configuration and start effect
-        LedfxEngine.updateConfig(ip, port, numLeds);
-        boolean success = LedfxEngine.setEffectOn(true);
+        LedfxEngine.updateConfig(mEngine, ip, port, numLeds);
+        boolean success = LedfxEngine.setEffectOn(mEngine, true);
 
         if (success) {
             if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.R) {
@@ -220,7 +221,7 @@ public class MainActivity extends Activity
      */
     private void stopEffect() {
         Log.d(TAG, "Playing, attempting to stop");
-        LedfxEngine.setEffectOn(false);
+        LedfxEngine.setEffectOn(mEngine, false);
         resetStatusView();
         isPlaying = false;
         EnableAudioApiUI(true);